@@ -21,7 +21,9 @@ Dev::ProcessData* Dev::GetProcessData()
 static const wi::unordered_map<std::string, Dev::CommandData::CommandType> CommandTypeLookup = {
     {"SCENE_IMPORT", Dev::CommandData::CommandType::SCENE_IMPORT},
     {"SCENE_PREVIEW", Dev::CommandData::CommandType::SCENE_PREVIEW},
-    {"SCENE_EXTRACT", Dev::CommandData::CommandType::SCENE_EXTRACT}
+    {"SCENE_EXTRACT", Dev::CommandData::CommandType::SCENE_EXTRACT},
+    {"BENCHMARK", Dev::CommandData::CommandType::BENCHMARK},
+    {"PACK_BUILD", Dev::CommandData::CommandType::PACK_BUILD}
 };
 
 static const std::string HelpMenuStr = R"([ Game Devtool Command Help ]
@@ -47,6 +49,14 @@ Options:
 
   SCENE_EXTRACT   Extract the scene into a GLTF file (.glb)
                   Usage:   Dev -t SCENE_EXTRACT -i my_scene.wiscene -o my_scene.glb
+
+  BENCHMARK       Run a runtime benchmark and print the timings
+                  Usage:   Dev -t BENCHMARK -i stream_index
+                  Available: stream_index, prefab_toggle
+
+  PACK_BUILD      Pack every file under a content directory into one pack file
+                  Takes OS paths relative to the working directory, not Data/Content
+                  Usage:   Dev -t PACK_BUILD -i Data/Content -o Data/Content.pack
 )";
 
 bool _internal_ReadCMD(wi::vector<std::string>& args)
@@ -69,6 +79,7 @@ bool _internal_ReadCMD(wi::vector<std::string>& args)
                     if ((i+1) < args.size())
                     {
                         Dev::GetCommandData()->type = CommandTypeLookup.find(std::string(args[i+1]))->second;
+                        Dev::GetCommandData()->has_command = true;
                     }
                     break;
                 }
@@ -77,6 +88,7 @@ bool _internal_ReadCMD(wi::vector<std::string>& args)
                     if ((i+1) < args.size())
                     {
                         Dev::GetCommandData()->input = "content/" + std::string(args[i+1]);
+                        Dev::GetCommandData()->input_path = std::string(args[i+1]);
                     }
                     break;
                 }
@@ -85,6 +97,7 @@ bool _internal_ReadCMD(wi::vector<std::string>& args)
                     if ((i+1) < args.size())
                     {
                         Dev::GetCommandData()->output = "content/" + std::string(args[i+1]);
+                        Dev::GetCommandData()->output_path = std::string(args[i+1]);
                     }
                     break;
                 }
@@ -126,6 +139,27 @@ bool Dev::ReadCMD(const wchar_t* win_args)
     return _internal_ReadCMD(args);
 }
 
+// Bundle sections are read back from memory where the archive has no source directory
+// so texture names are swapped to actual paths while a section is written, and swapped back after
+wi::vector<uint8_t> _DEV_bundle_sections[size_t(Game::Scene::Bundle::Section::COUNT)];
+void _DEV_bundle_texture_paths(wi::scene::Scene& scene, const std::string& root_path, bool to_actual)
+{
+    for(int i = 0; i < scene.materials.GetCount(); ++i)
+    {
+        wi::scene::MaterialComponent& material = scene.materials[i];
+        for(int j = 0; j < wi::scene::MaterialComponent::TEXTURESLOT_COUNT; ++j)
+        {
+            std::string& texture_name = material.textures[j].name;
+            if(texture_name == "")
+                continue;
+            if(to_actual)
+                texture_name = root_path + texture_name;
+            else if(texture_name.compare(0, root_path.length(), root_path) == 0)
+                texture_name = texture_name.substr(root_path.length());
+        }
+    }
+}
+
 void _DEV_scene_import()
 {
     static uint32_t cycle = 0;
@@ -147,6 +181,11 @@ void _DEV_scene_import()
                 wi::ecs::EntitySerializer seri;
                 wi::Archive ar_bounds = wi::Archive(bounds_file, false);
                 Game::GetScene()->wiscene.bounds.Serialize(ar_bounds, seri);
+
+                wi::Archive ar_bounds_bundle;
+                ar_bounds_bundle.SetReadModeAndResetPos(false);
+                Game::GetScene()->wiscene.bounds.Serialize(ar_bounds_bundle, seri);
+                ar_bounds_bundle.WriteData(_DEV_bundle_sections[size_t(Game::Scene::Bundle::Section::BOUNDS)]);
             }
 
             // Make texture paths relative to wiscene file
@@ -270,6 +309,26 @@ void _DEV_scene_import()
                                         );
                                     wi::jobsystem::Wait(seri.ctx);
                                 }
+                                // Same for the bundle
+                                {
+                                    std::string root_path = wi::helper::GetDirectoryFromPath(Game::Filesystem::GetActualPath(Dev::GetCommandData()->input));
+                                    _DEV_bundle_texture_paths(Game::GetScene()->wiscene, root_path, true);
+
+                                    wi::ecs::EntitySerializer seri;
+                                    wi::Archive ar_prev_bundle;
+                                    ar_prev_bundle.SetReadModeAndResetPos(false);
+                                    transform->Serialize(ar_prev_bundle, seri);
+                                    Game::GetScene()->wiscene.Entity_Serialize(
+                                            ar_prev_bundle,
+                                            seri,
+                                            object.meshID,
+                                            wi::scene::Scene::EntitySerializeFlags::KEEP_INTERNAL_ENTITY_REFERENCES
+                                        );
+                                    wi::jobsystem::Wait(seri.ctx);
+                                    ar_prev_bundle.WriteData(_DEV_bundle_sections[size_t(Game::Scene::Bundle::Section::PREVIEW)]);
+
+                                    _DEV_bundle_texture_paths(Game::GetScene()->wiscene, root_path, false);
+                                }
 
                                 entity_to_remove.insert(object.meshID);
                             }
@@ -282,7 +341,7 @@ void _DEV_scene_import()
                 }
                 for(auto& entity : entity_to_remove)
                 {
-                    Game::GetScene()->wiscene.Entity_Remove(entity,false);
+                    Game::GetScene()->Entity_Remove(entity);
                 }
             }
             break;
@@ -295,6 +354,23 @@ void _DEV_scene_import()
             wi::Archive scene_save = wi::Archive(wiscene_file, false);
             Game::GetScene()->wiscene.Serialize(scene_save);
 
+            // Pack everything into a bundle too, streaming prefers it over the loose files
+            {
+                std::string root_path = wi::helper::GetDirectoryFromPath(wiscene_file);
+                _DEV_bundle_texture_paths(Game::GetScene()->wiscene, root_path, true);
+
+                wi::Archive scene_bundle;
+                scene_bundle.SetReadModeAndResetPos(false);
+                Game::GetScene()->wiscene.Serialize(scene_bundle);
+                scene_bundle.WriteData(_DEV_bundle_sections[size_t(Game::Scene::Bundle::Section::SCENE)]);
+
+                _DEV_bundle_texture_paths(Game::GetScene()->wiscene, root_path, false);
+
+                std::string bundle_file = wi::helper::ReplaceExtension(wiscene_file, "bundle");
+                if(!Game::Scene::Bundle::Write(bundle_file, _DEV_bundle_sections))
+                    wi::backlog::post("Failed to write bundle " + bundle_file, wi::backlog::LogLevel::Error);
+            }
+
             break;
         }
         case 3:
@@ -453,6 +529,26 @@ void Dev::Execute(float dt)
             {
                 break;
             }
+            case CommandData::CommandType::BENCHMARK:
+            {
+                Benchmark::Run(wi::helper::GetFileNameFromPath(GetCommandData()->input));
+                execution_done = true;
+                wi::platform::Exit();
+                break;
+            }
+            case CommandData::CommandType::PACK_BUILD:
+            {
+                // The pack is built from the OS filesystem, it is what the virtual paths are served from later
+                std::string pack_file = GetCommandData()->output_path;
+                std::string content_path = GetCommandData()->input_path;
+                if(Game::Filesystem::PackWrite(pack_file, content_path))
+                    wi::backlog::post("Packed " + content_path + " into " + pack_file);
+                else
+                    wi::backlog::post("Failed to write pack " + pack_file, wi::backlog::LogLevel::Error);
+                execution_done = true;
+                wi::platform::Exit();
+                break;
+            }
         }
     }
 
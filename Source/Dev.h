@@ -11,10 +11,15 @@ namespace Dev
             SCENE_IMPORT,
             SCENE_PREVIEW,
             SCENE_EXTRACT,
+            BENCHMARK,
+            PACK_BUILD,
         }; 
         CommandType type; // -t
+        bool has_command = false; // Set once -t is given, commands work on the loose content and leave the pack unmounted
         std::string input; // -i
         std::string output; // -o
+        std::string input_path; // -i as given, for commands that take OS paths
+        std::string output_path; // -o as given, for commands that take OS paths
     };
 
     struct ProcessData
@@ -34,6 +39,11 @@ namespace Dev
     void UpdateHook(); // Development Interconnect (with Embark Studios' Skyhook perhaps?)
     void UpdateUI(); // Development UI
 
+    namespace Benchmark
+    {
+        void Run(const std::string& name); // Run the named benchmark, print the results and quit
+    }
+
     namespace IO
     {
         void Import_GLTF(const std::string& fileName, wi::scene::Scene& scene);
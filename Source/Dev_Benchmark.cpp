@@ -0,0 +1,144 @@
+#include "Dev.h"
+#include "Scene.h"
+
+#include <iostream>
+#include <random>
+
+void _internal_Benchmark_Print(const std::string& text)
+{
+    std::cout << text << std::endl;
+    wi::backlog::post(text);
+}
+
+// Per-frame cost of the prefab stream update with a growing amount of DISTANCE prefabs scattered around the world
+// The loader walks across the world, the stream index is measured against visiting every prefab on every update
+void _internal_Benchmark_StreamIndex()
+{
+    Game::Scene* scene = Game::GetScene();
+    const std::string benchmark_file = "benchmark/stream_index.wiscene";
+    const uint32_t frame_count = 120;
+    const float frame_dt = 1.f / 60.f;
+
+    // The file does not exist, LOADING keeps the prefabs in range from requesting it, both paths see the same archive
+    Game::Scene::Archive& archive = scene->scene_db[benchmark_file];
+    archive.file = benchmark_file;
+    archive.bounds = wi::primitive::AABB(XMFLOAT3(-4.f, -4.f, -4.f), XMFLOAT3(4.f, 4.f, 4.f));
+    archive.load_state = Game::Scene::Archive::LoadState::LOADING;
+
+    for(uint32_t prefab_count : {1000u, 10000u, 100000u})
+    {
+        std::mt19937 rng(prefab_count);
+        float extent = std::sqrt(float(prefab_count)) * 32.f; // Keep the prefab density the same
+        std::uniform_real_distribution<float> position(-extent, extent);
+
+        wi::vector<wi::ecs::Entity> entities;
+        for(uint32_t i = 0; i < prefab_count; ++i)
+        {
+            wi::ecs::Entity entity = wi::ecs::CreateEntity();
+            wi::scene::TransformComponent& transform = scene->wiscene.transforms.Create(entity);
+            transform.Translate(XMFLOAT3(position(rng), 0.f, position(rng)));
+            transform.UpdateTransform();
+            Game::Scene::Component_Prefab& prefab = scene->prefabs.Create(entity);
+            prefab.file = benchmark_file;
+            prefab.stream_mode = Game::Scene::Prefab::StreamMode::DISTANCE;
+            entities.push_back(entity);
+        }
+
+        wi::jobsystem::context ctx;
+        auto run_frames = [&](bool brute_force){
+            scene->stream_index.brute_force = brute_force;
+            scene->stream_loader_bounds = XMFLOAT4(-extent, 0.f, 0.f, 100.f);
+            scene->RunPrefabUpdateSystem(frame_dt, ctx); // Initial indexing
+
+            wi::Timer timer;
+            for(uint32_t frame = 0; frame < frame_count; ++frame)
+            {
+                scene->stream_loader_bounds.x = -extent + 2.f * extent * float(frame) / float(frame_count);
+                scene->RunPrefabUpdateSystem(frame_dt, ctx);
+            }
+            return timer.elapsed_milliseconds() / double(frame_count);
+        };
+        double index_time = run_frames(false);
+        double brute_force_time = run_frames(true);
+        scene->stream_index.brute_force = false;
+
+        _internal_Benchmark_Print("[stream_index] prefabs: " + std::to_string(prefab_count) + " - index: " + std::to_string(index_time) + " ms/frame - brute force: " + std::to_string(brute_force_time) + " ms/frame");
+
+        for(auto& entity : entities)
+        {
+            scene->prefabs.Remove(entity);
+            scene->wiscene.transforms.Remove(entity);
+        }
+        scene->RunPrefabUpdateSystem(frame_dt, ctx); // Flush removed prefabs from the index
+    }
+
+    scene->scene_db.erase(benchmark_file);
+}
+
+// Disabling and enabling a prefab sized set of entities, one entity at a time against the batched path
+void _internal_Benchmark_PrefabToggle()
+{
+    Game::Scene* scene = Game::GetScene();
+    const uint32_t toggle_count = 10;
+
+    for(uint32_t entity_count : {1000u, 10000u})
+    {
+        wi::vector<wi::ecs::Entity> entities;
+        for(uint32_t i = 0; i < entity_count; ++i)
+        {
+            wi::ecs::Entity entity = wi::ecs::CreateEntity();
+            scene->wiscene.transforms.Create(entity);
+            scene->wiscene.objects.Create(entity);
+            if((i % 8) == 0)
+                scene->wiscene.lights.Create(entity);
+            if((i % 4) == 0)
+                scene->wiscene.rigidbodies.Create(entity); // Goes through the serialized fallback
+            entities.push_back(entity);
+        }
+
+        wi::Timer timer;
+        for(uint32_t toggle = 0; toggle < toggle_count; ++toggle)
+        {
+            for(auto& entity : entities)
+            {
+                scene->Entity_Disable(entity);
+            }
+            for(auto& entity : entities)
+            {
+                scene->Entity_Enable(entity);
+            }
+        }
+        double single_time = timer.elapsed_milliseconds() / double(toggle_count);
+
+        timer.record();
+        for(uint32_t toggle = 0; toggle < toggle_count; ++toggle)
+        {
+            scene->Entity_DisableBatch(entities);
+            scene->Entity_EnableBatch(entities);
+        }
+        double batch_time = timer.elapsed_milliseconds() / double(toggle_count);
+
+        _internal_Benchmark_Print("[prefab_toggle] entities: " + std::to_string(entity_count) + " - per entity: " + std::to_string(single_time) + " ms - batch: " + std::to_string(batch_time) + " ms");
+
+        for(auto& entity : entities)
+        {
+            scene->Entity_Remove(entity);
+        }
+    }
+}
+
+void Dev::Benchmark::Run(const std::string& name)
+{
+    static const wi::unordered_map<std::string, std::function<void()>> benchmarks = {
+        {"stream_index", _internal_Benchmark_StreamIndex},
+        {"prefab_toggle", _internal_Benchmark_PrefabToggle},
+    };
+
+    auto find_benchmark = benchmarks.find(name);
+    if(find_benchmark == benchmarks.end())
+    {
+        _internal_Benchmark_Print("Benchmark not found: " + name);
+        return;
+    }
+    find_benchmark->second();
+}
@@ -1,4 +1,21 @@
 #include "Filesystem.h"
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <thread>
+#include <fstream>
+#include <algorithm>
+#include <cstring>
+#include <string_view>
+#ifdef _WIN32
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
 
 namespace Game
 {
@@ -8,84 +25,446 @@ namespace Game
         {
             std::string actualpath;
             uint32_t priority = 0; // For file overlay, 0 is lowest
+        };
 
-            void Serialize(wi::Archive& archive, wi::ecs::EntitySerializer& seri){};
+        // Mount points live in a character trie keyed by virtual path, resolving a file walks it once
+        struct _internal_fsnode
+        {
+            wi::vector<std::pair<char, uint32_t>> children; // Sorted by character
+            uint32_t base = ~0u; // Index into the mounts
+            wi::vector<uint32_t> overlays; // Indices into the mounts, in registration order
         };
 
-        wi::ecs::ComponentManager<_internal_fsdata> fsdb;
-        
-        wi::unordered_map<std::string, wi::ecs::Entity> fslookup;
-        wi::unordered_map<std::string, wi::vector<wi::ecs::Entity>> fsoverlaylookup;
-        
-        std::atomic<wi::ecs::Entity> vfsid_gen { wi::ecs::INVALID_ENTITY + 1 };
-        std::atomic<wi::ecs::Entity> fsid_gen { wi::ecs::INVALID_ENTITY + 1 };
+        // Owns one mapped file, unmapped when the last view lets go
+        struct _internal_fsmapping
+        {
+            void* address = nullptr;
+            size_t size = 0;
+#ifdef _WIN32
+            HANDLE file_handle = INVALID_HANDLE_VALUE;
+            HANDLE mapping_handle = NULL;
+#endif
 
-        void Register_FS(std::string virtualpath, std::string actualpath, bool file)
+            ~_internal_fsmapping()
+            {
+#ifdef _WIN32
+                if(address != nullptr)
+                    UnmapViewOfFile(address);
+                if(mapping_handle != NULL)
+                    CloseHandle(mapping_handle);
+                if(file_handle != INVALID_HANDLE_VALUE)
+                    CloseHandle(file_handle);
+#else
+                if(address != nullptr)
+                    munmap(address, size);
+#endif
+            }
+        };
+
+        FileView FileView::Slice(size_t offset, size_t count) const
         {
-            auto fsid = fsid_gen.fetch_add(1);
-            auto& fsdata = fsdb.Create(fsid);
-            fsdata.actualpath = actualpath;
-            fslookup[virtualpath] = fsid;
+            FileView slice;
+            if((offset > size) || (count > (size - offset)))
+                return slice;
+            slice.data = data + offset;
+            slice.size = count;
+            slice.mapping = mapping;
+            return slice;
         }
-        void Register_FSOverlay(std::string virtualpath, std::string actualpath, bool file)
+
+        // Read-only pack file, one file that holds many
+        // |- header -> magic, version, entry count, name table size
+        // |- entry table -> byte offset, size and name range of each entry, sorted by name
+        // |- name table -> entry names relative to the pack root, '/' separated
+        // |- entries -> each one starts on a page boundary
+        struct _internal_fspack
         {
-            auto fsid = fsid_gen.fetch_add(1);
-            auto& fsdata = fsdb.Create(fsid);
-            fsdata.actualpath = actualpath;
-            
-            auto fsoverlayget = fsoverlaylookup.find(virtualpath);
-            if(fsoverlayget != fsoverlaylookup.end())
+            static constexpr uint32_t MAGIC = 0x4b434150; // PACK
+            static constexpr uint32_t VERSION = 1;
+            static constexpr uint64_t ALIGNMENT = 4096;
+            struct Entry
+            {
+                uint64_t offset = 0;
+                uint64_t size = 0;
+                uint32_t name_offset = 0;
+                uint32_t name_size = 0;
+            };
+            std::string virtualpath;
+            std::string packfile;
+            uint32_t priority = 0;
+            wi::vector<Entry> entries;
+            std::string names;
+            FileView view; // The whole pack stays mapped, entries are slices of it
+
+            std::string_view Name(const Entry& entry) const
             {
-                fsoverlaylookup[virtualpath].push_back(fsid);
+                return std::string_view(names).substr(entry.name_offset, entry.name_size);
             }
-            else
+            const Entry* Find(std::string_view name) const
             {
-                fsoverlaylookup[virtualpath] = { fsid };
+                auto entry_find = std::lower_bound(entries.begin(), entries.end(), name, [this](const Entry& entry, std::string_view value){
+                    return Name(entry) < value;
+                });
+                if(entry_find == entries.end() || Name(*entry_find) != name)
+                    return nullptr;
+                return &(*entry_find);
             }
-        }
-        std::string GetActualPath(const std::string& file)
+        };
+        // The mount table is published as an immutable snapshot, readers only take a lock when a newer one was published
+        // Register_FS* copies the current snapshot, changes the copy and swaps it in, a replaced snapshot lives on until its last reader lets go
+        struct _internal_fsmounts
         {
-            std::string actual_file = "";
-            uint32_t max_priority = 0;
-            // Search overlays first and pick priority
-            for(auto& fsobj : fsoverlaylookup)
+            uint64_t generation = 0;
+            wi::vector<_internal_fsdata> mounts;
+            wi::vector<_internal_fsnode> trie = wi::vector<_internal_fsnode>(1);
+            wi::vector<std::shared_ptr<_internal_fspack>> packs; // Highest priority first, later mounts first on ties
+
+            _internal_fsnode& Trie_Insert(const std::string& virtualpath)
             {
-                // Just do the stupid string search technique, DON'T YOU DARE WASTE CPU CYCLES JUST FOR FILE REDIRECTION
-                auto fso_str = fsobj.first;
-                for(auto& fso_data_id : fsobj.second)
+                uint32_t node_index = 0;
+                for(char c : virtualpath)
                 {
-                    auto fso_data = fsdb.GetComponent(fso_data_id);
-                    if((std::string(file.substr(0,fso_str.size())).compare(fso_str) == 0) && (fso_data->priority >= max_priority))
+                    auto& children = trie[node_index].children;
+                    auto child_find = std::lower_bound(children.begin(), children.end(), c, [](const std::pair<char, uint32_t>& child, char value){
+                        return child.first < value;
+                    });
+                    if(child_find != children.end() && child_find->first == c)
+                    {
+                        node_index = child_find->second;
+                    }
+                    else
                     {
-                        // Concat the path and set the maxxest priority
-                        actual_file = fso_data->actualpath + file.substr(fso_str.size(), file.size() - fso_str.size());
-                        max_priority = fso_data->priority;
+                        uint32_t child_index = uint32_t(trie.size());
+                        children.insert(child_find, {c, child_index});
+                        trie.emplace_back();
+                        node_index = child_index;
                     }
                 }
+                return trie[node_index];
+            }
+        };
+        std::shared_ptr<const _internal_fsmounts> fsmounts = std::make_shared<_internal_fsmounts>();
+        std::atomic<uint64_t> fsmounts_generation = 0;
+        std::mutex fsmounts_write_lock; // Guards fsmounts, readers only take it when the generation moved on
+        thread_local std::shared_ptr<const _internal_fsmounts> fsmounts_local;
+
+        // Every thread holds its own reference to the snapshot it last saw, so the common path is one atomic load and never touches a shared refcount
+        // A replaced snapshot is retired once the last thread holding it refreshes
+        // The returned reference stays valid until this thread calls _internal_Mounts again
+        const _internal_fsmounts& _internal_Mounts()
+        {
+            if(fsmounts_local == nullptr || fsmounts_local->generation != fsmounts_generation.load(std::memory_order_acquire))
+            {
+                std::scoped_lock lock(fsmounts_write_lock);
+                fsmounts_local = fsmounts;
+            }
+            return *fsmounts_local;
+        }
+        template<typename Update>
+        void _internal_Mounts_Update(Update&& update)
+        {
+            std::scoped_lock lock(fsmounts_write_lock);
+            auto mounts = std::make_shared<_internal_fsmounts>(*fsmounts);
+            mounts->generation++;
+            update(*mounts);
+            fsmounts = std::move(mounts);
+            fsmounts_generation.store(fsmounts->generation, std::memory_order_release);
+        }
+
+        // Resolved paths are cached per thread, so lookups never contend
+        // A cache is dropped as a whole when it sees a newer snapshot or fills up
+        struct _internal_fsresolve
+        {
+            std::string actualpath;
+            int64_t overlay_priority = -1; // Priority of the overlay that resolved the path, -1 if it came from a base mount
+        };
+        struct _internal_fscache
+        {
+            static constexpr size_t CAPACITY = 4096;
+            uint64_t generation = 0;
+            wi::unordered_map<std::string, _internal_fsresolve> entries;
+        };
+        thread_local _internal_fscache fscache;
+
+        void Register_FS(std::string virtualpath, std::string actualpath, bool file)
+        {
+            _internal_Mounts_Update([&](_internal_fsmounts& mounts){
+                mounts.Trie_Insert(virtualpath).base = uint32_t(mounts.mounts.size());
+                mounts.mounts.push_back({actualpath});
+            });
+        }
+        void Register_FSOverlay(std::string virtualpath, std::string actualpath, bool file)
+        {
+            _internal_Mounts_Update([&](_internal_fsmounts& mounts){
+                mounts.Trie_Insert(virtualpath).overlays.push_back(uint32_t(mounts.mounts.size()));
+                mounts.mounts.push_back({actualpath});
+            });
+        }
+        _internal_fsresolve _internal_Resolve(const _internal_fsmounts& mounts, const std::string& file)
+        {
+            if(fscache.generation != mounts.generation)
+            {
+                fscache.entries.clear();
+                fscache.generation = mounts.generation;
             }
+            auto cache_find = fscache.entries.find(file);
+            if(cache_find != fscache.entries.end())
+                return cache_find->second;
+
+            // Walk the trie along the path, every node passed is a mount prefix of the file
+            // Overlays win over base mounts, the highest priority overlay wins and ties go to the longer and later mount
+            // Base mounts resolve to the longest matching prefix
+            const _internal_fsdata* overlay_data = nullptr;
+            size_t overlay_length = 0;
+            const _internal_fsdata* base_data = nullptr;
+            size_t base_length = 0;
 
-            // If it does not exist on overlay then we can seek from base FS redirect
-            if(actual_file.empty())
+            uint32_t node_index = 0;
+            size_t depth = 0;
+            while(true)
             {
-                for(auto& fsobj : fslookup)
+                auto& node = mounts.trie[node_index];
+                for(auto& overlay_index : node.overlays)
                 {
-                    // Just do the stupid string search technique, DON'T YOU DARE WASTE CPU CYCLES JUST FOR FILE REDIRECTION
-                    auto fso_str = fsobj.first;
-                    auto fso_data = fsdb.GetComponent(fsobj.second);
-                    if(std::string(file.substr(0,fso_str.size())).compare(fso_str) == 0)
+                    auto& fso_data = mounts.mounts[overlay_index];
+                    if((overlay_data == nullptr) || (fso_data.priority >= overlay_data->priority))
                     {
-                        actual_file = fso_data->actualpath + file.substr(fso_str.size(), file.size() - fso_str.size());
+                        overlay_data = &fso_data;
+                        overlay_length = depth;
                     }
                 }
+                if(node.base != ~0u)
+                {
+                    base_data = &mounts.mounts[node.base];
+                    base_length = depth;
+                }
+
+                if(depth == file.size())
+                    break;
+                auto child_find = std::lower_bound(node.children.begin(), node.children.end(), file[depth], [](const std::pair<char, uint32_t>& child, char value){
+                    return child.first < value;
+                });
+                if(child_find == node.children.end() || child_find->first != file[depth])
+                    break;
+                node_index = child_find->second;
+                ++depth;
             }
 
-            return actual_file;
+            _internal_fsresolve resolve;
+            if(overlay_data != nullptr)
+            {
+                resolve.actualpath = overlay_data->actualpath + file.substr(overlay_length);
+                resolve.overlay_priority = overlay_data->priority;
+            }
+            else if(base_data != nullptr)
+                resolve.actualpath = base_data->actualpath + file.substr(base_length);
+
+            if(fscache.entries.size() >= _internal_fscache::CAPACITY)
+                fscache.entries.clear();
+            fscache.entries[file] = resolve;
+
+            return resolve;
         }
-        bool FileRead(const std::string &file, wi::vector<uint8_t> &data)
+        std::string GetActualPath(const std::string& file)
+        {
+            return _internal_Resolve(_internal_Mounts(), file).actualpath;
+        }
+
+        // Finds the pack entry for a virtual file, a loose overlay with a higher priority than the pack takes the file over
+        bool _internal_Pack_Find(const std::string& file, std::shared_ptr<_internal_fspack>& pack, const _internal_fspack::Entry*& entry)
         {
-            wi::helper::FileRead(GetActualPath(file), data);
+            auto& mounts = _internal_Mounts();
+            for(auto& fspack : mounts.packs)
+            {
+                if(file.compare(0, fspack->virtualpath.size(), fspack->virtualpath) != 0)
+                    continue;
+                const _internal_fspack::Entry* entry_find = fspack->Find(std::string_view(file).substr(fspack->virtualpath.size()));
+                if(entry_find == nullptr)
+                    continue;
+                if(_internal_Resolve(mounts, file).overlay_priority > int64_t(fspack->priority))
+                    return false;
+                pack = fspack;
+                entry = entry_find;
+                return true;
+            }
             return false;
         }
+        bool Register_FSPack(std::string virtualpath, std::string packfile, uint32_t priority)
+        {
+            auto pack = std::make_shared<_internal_fspack>();
+            pack->virtualpath = virtualpath;
+            pack->packfile = packfile;
+            pack->priority = priority;
+
+            if(!MapActualFile(packfile, pack->view))
+                return false;
+            uint64_t file_size = pack->view.size;
+
+            uint32_t header[4] = {}; // magic, version, entry count, name table size
+            if(file_size < sizeof(header))
+                return false;
+            std::memcpy(header, pack->view.data, sizeof(header));
+            if((header[0] != _internal_fspack::MAGIC) || (header[1] != _internal_fspack::VERSION))
+                return false;
+            uint64_t entry_bytes = uint64_t(header[2]) * sizeof(_internal_fspack::Entry);
+            if((file_size - sizeof(header)) < (entry_bytes + header[3]))
+                return false;
+            pack->entries.resize(header[2]);
+            std::memcpy(pack->entries.data(), pack->view.data + sizeof(header), size_t(entry_bytes));
+            pack->names.assign((const char*)pack->view.data + sizeof(header) + entry_bytes, header[3]);
+            for(size_t i = 0; i < pack->entries.size(); ++i)
+            {
+                auto& entry = pack->entries[i];
+                if((entry.offset > file_size) || (entry.size > (file_size - entry.offset)))
+                    return false;
+                if(uint64_t(entry.name_offset) + entry.name_size > pack->names.size())
+                    return false;
+                if((i > 0) && !(pack->Name(pack->entries[i - 1]) < pack->Name(entry)))
+                    return false;
+            }
+
+            _internal_Mounts_Update([&](_internal_fsmounts& mounts){
+                auto pack_insert = std::find_if(mounts.packs.begin(), mounts.packs.end(), [priority](const std::shared_ptr<_internal_fspack>& fspack){
+                    return fspack->priority <= priority;
+                });
+                mounts.packs.insert(pack_insert, pack);
+            });
+            return true;
+        }
+        bool MapActualFile(const std::string& actualpath, FileView& view)
+        {
+            auto mapping = std::make_shared<_internal_fsmapping>();
+#ifdef _WIN32
+            std::wstring actualpath_wide;
+            wi::helper::StringConvert(actualpath, actualpath_wide);
+            mapping->file_handle = CreateFileW(actualpath_wide.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+            if(mapping->file_handle == INVALID_HANDLE_VALUE)
+                return false;
+            LARGE_INTEGER file_size = {};
+            if(!GetFileSizeEx(mapping->file_handle, &file_size) || (file_size.QuadPart == 0))
+                return false;
+            mapping->mapping_handle = CreateFileMappingW(mapping->file_handle, NULL, PAGE_READONLY, 0, 0, NULL);
+            if(mapping->mapping_handle == NULL)
+                return false;
+            mapping->address = MapViewOfFile(mapping->mapping_handle, FILE_MAP_READ, 0, 0, 0);
+            if(mapping->address == nullptr)
+                return false;
+            mapping->size = size_t(file_size.QuadPart);
+#else
+            int file_descriptor = open(actualpath.c_str(), O_RDONLY);
+            if(file_descriptor < 0)
+                return false;
+            struct stat file_stat = {};
+            if((fstat(file_descriptor, &file_stat) != 0) || (file_stat.st_size <= 0))
+            {
+                close(file_descriptor);
+                return false;
+            }
+            void* address = mmap(nullptr, size_t(file_stat.st_size), PROT_READ, MAP_PRIVATE, file_descriptor, 0);
+            close(file_descriptor); // The mapping keeps its own reference to the file
+            if(address == MAP_FAILED)
+                return false;
+            mapping->address = address;
+            mapping->size = size_t(file_stat.st_size);
+#endif
+            view.data = (const uint8_t*)mapping->address;
+            view.size = mapping->size;
+            view.mapping = mapping;
+            return true;
+        }
+        bool PackMap(const std::string& file, FileView& view)
+        {
+            std::shared_ptr<_internal_fspack> pack;
+            const _internal_fspack::Entry* entry = nullptr;
+            if(!_internal_Pack_Find(file, pack, entry))
+                return false;
+            view = pack->view.Slice(size_t(entry->offset), size_t(entry->size));
+            return true;
+        }
+        bool MapFile(const std::string& file, FileView& view)
+        {
+            if(PackMap(file, view))
+                return true;
+            return MapActualFile(GetActualPath(file), view);
+        }
+        bool PackWrite(const std::string& packfile, const std::string& directory)
+        {
+            std::error_code directory_error;
+            wi::vector<std::pair<std::string, std::filesystem::path>> files;
+            for(auto& directory_entry : std::filesystem::recursive_directory_iterator(directory, directory_error))
+            {
+                if(!directory_entry.is_regular_file())
+                    continue;
+                files.push_back({std::filesystem::relative(directory_entry.path(), directory).generic_string(), directory_entry.path()});
+            }
+            if(directory_error)
+                return false;
+            std::sort(files.begin(), files.end(), [](const auto& a, const auto& b){ return a.first < b.first; });
+
+            wi::vector<_internal_fspack::Entry> entries(files.size());
+            std::string names;
+            for(size_t i = 0; i < files.size(); ++i)
+            {
+                std::error_code file_size_error;
+                entries[i].size = std::filesystem::file_size(files[i].second, file_size_error);
+                if(file_size_error)
+                    return false;
+                entries[i].name_offset = uint32_t(names.size());
+                entries[i].name_size = uint32_t(files[i].first.size());
+                names += files[i].first;
+            }
+
+            uint32_t header[4] = {_internal_fspack::MAGIC, _internal_fspack::VERSION, uint32_t(entries.size()), uint32_t(names.size())};
+            uint64_t offset = sizeof(header) + entries.size() * sizeof(_internal_fspack::Entry) + names.size();
+            for(auto& entry : entries)
+            {
+                offset = (offset + _internal_fspack::ALIGNMENT - 1) & ~(_internal_fspack::ALIGNMENT - 1);
+                entry.offset = offset;
+                offset += entry.size;
+            }
+
+            // Written next to the pack and swapped in at the end, a running game may still have the old one mapped
+            std::string temp_packfile = packfile + ".tmp";
+            std::ofstream pack_stream(temp_packfile, std::ios::binary | std::ios::trunc);
+            if(!pack_stream.is_open())
+                return false;
+            pack_stream.write((const char*)header, sizeof(header));
+            pack_stream.write((const char*)entries.data(), std::streamsize(entries.size() * sizeof(_internal_fspack::Entry)));
+            pack_stream.write(names.data(), std::streamsize(names.size()));
+            wi::vector<uint8_t> filedata;
+            bool pack_success = true;
+            for(size_t i = 0; i < files.size(); ++i)
+            {
+                if(!wi::helper::FileRead(files[i].second.string(), filedata) || (filedata.size() != entries[i].size))
+                {
+                    pack_success = false;
+                    break;
+                }
+                pack_stream.seekp(std::streamoff(entries[i].offset));
+                pack_stream.write((const char*)filedata.data(), std::streamsize(filedata.size()));
+            }
+            pack_stream.close();
+            pack_success = pack_success && bool(pack_stream);
+            std::error_code rename_error;
+            if(pack_success)
+                std::filesystem::rename(temp_packfile, packfile, rename_error);
+            if(!pack_success || rename_error)
+            {
+                std::filesystem::remove(temp_packfile, rename_error);
+                return false;
+            }
+            return true;
+        }
+        bool FileRead(const std::string &file, wi::vector<uint8_t> &data)
+        {
+            FileView view;
+            if(PackMap(file, view))
+            {
+                data.assign(view.data, view.data + view.size);
+                return true;
+            }
+            return wi::helper::FileRead(GetActualPath(file), data);
+        }
         bool FileWrite(const std::string &file, const uint8_t *data, size_t size)
         {
             wi::helper::FileWrite(GetActualPath(file), data, size);
@@ -93,8 +472,172 @@ namespace Game
         }
         bool FileExists(const std::string &file)
         {
-            wi::helper::FileExists(GetActualPath(file));
-            return false;
+            std::shared_ptr<_internal_fspack> pack;
+            const _internal_fspack::Entry* entry = nullptr;
+            if(_internal_Pack_Find(file, pack, entry))
+                return true;
+            return wi::helper::FileExists(GetActualPath(file));
+        }
+        void Prefault(const FileView& view)
+        {
+            volatile uint8_t page_touch = 0;
+            for(size_t offset = 0; offset < view.size; offset += 4096)
+            {
+                page_touch += view.data[offset];
+            }
+            if(view.size > 0)
+                page_touch += view.data[view.size - 1];
+        }
+        bool IsResident(const FileView& view)
+        {
+            if(view.empty())
+                return false;
+#ifdef _WIN32
+            const uintptr_t page_size = 4096;
+#else
+            const uintptr_t page_size = uintptr_t(sysconf(_SC_PAGESIZE));
+#endif
+            uintptr_t page_begin = uintptr_t(view.data) & ~(page_size - 1);
+            uintptr_t page_end = uintptr_t(view.data) + view.size;
+            size_t page_count = size_t((page_end - page_begin + page_size - 1) / page_size);
+#ifdef _WIN32
+            wi::vector<PSAPI_WORKING_SET_EX_INFORMATION> pages(page_count);
+            for(size_t i = 0; i < page_count; ++i)
+            {
+                pages[i].VirtualAddress = (PVOID)(page_begin + i * page_size);
+            }
+            if(!QueryWorkingSetEx(GetCurrentProcess(), pages.data(), DWORD(pages.size() * sizeof(PSAPI_WORKING_SET_EX_INFORMATION))))
+                return false;
+            for(auto& page : pages)
+            {
+                if(!page.VirtualAttributes.Valid)
+                    return false;
+            }
+#else
+            wi::vector<unsigned char> pages(page_count);
+            if(mincore((void*)page_begin, size_t(page_end - page_begin), pages.data()) != 0)
+                return false;
+            for(auto& page : pages)
+            {
+                if((page & 1) == 0)
+                    return false;
+            }
+#endif
+            return true;
+        }
+
+        // Priority queue of I/O tasks served by a small pool of threads
+        struct _internal_iotask
+        {
+            float priority = 0.f;
+            uint64_t sequence = 0;
+            std::function<void()> task;
+        };
+        struct _internal_ioservice
+        {
+            std::mutex lock;
+            std::condition_variable task_condition; // I/O threads wait for tasks
+            wi::vector<_internal_iotask> tasks; // Heap, front is the next task
+            wi::vector<std::thread> threads;
+            uint32_t thread_count = 2;
+            uint32_t queue_depth = 64;
+            uint64_t sequence = 0;
+            bool exiting = false;
+
+            static bool Later(const _internal_iotask& a, const _internal_iotask& b)
+            {
+                if(a.priority != b.priority)
+                    return a.priority > b.priority;
+                return a.sequence > b.sequence;
+            }
+            void Run()
+            {
+                while(true)
+                {
+                    _internal_iotask next;
+                    {
+                        std::unique_lock task_sync(lock);
+                        task_condition.wait(task_sync, [this]{ return exiting || !tasks.empty(); });
+                        if(exiting)
+                            return;
+                        std::pop_heap(tasks.begin(), tasks.end(), Later);
+                        next = std::move(tasks.back());
+                        tasks.pop_back();
+                    }
+                    next.task();
+                }
+            }
+            // Needs lock held
+            void Spawn()
+            {
+                while(threads.size() < std::max(thread_count, 1u))
+                {
+                    threads.emplace_back([this]{ Run(); });
+                }
+            }
+            ~_internal_ioservice()
+            {
+                {
+                    std::scoped_lock exit_sync(lock);
+                    exiting = true;
+                }
+                task_condition.notify_all();
+                for(auto& thread : threads)
+                {
+                    thread.join();
+                }
+            }
+        };
+        _internal_ioservice ioservice;
+
+        void IO_Configure(uint32_t thread_count, uint32_t queue_depth)
+        {
+            std::scoped_lock lock(ioservice.lock);
+            ioservice.thread_count = thread_count;
+            ioservice.queue_depth = queue_depth;
+            if(!ioservice.threads.empty())
+                ioservice.Spawn();
+        }
+        bool IO_Execute(float priority, std::function<void()> task)
+        {
+            {
+                std::scoped_lock task_sync(ioservice.lock);
+                if(ioservice.exiting || (ioservice.tasks.size() >= std::max(ioservice.queue_depth, 1u)))
+                    return false;
+                ioservice.Spawn();
+                ioservice.tasks.push_back({priority, ioservice.sequence++, std::move(task)});
+                std::push_heap(ioservice.tasks.begin(), ioservice.tasks.end(), _internal_ioservice::Later);
+            }
+            ioservice.task_condition.notify_one();
+            return true;
+        }
+        ReadResult _internal_Read(const std::string& file, uint64_t offset, uint64_t size)
+        {
+            ReadResult result;
+            FileView view;
+            if(!MapFile(file, view) || (offset > view.size))
+                return result;
+            result.view = view.Slice(size_t(offset), size_t(std::min(size, uint64_t(view.size) - offset)));
+            Prefault(result.view);
+            result.success = true;
+            return result;
+        }
+        std::future<ReadResult> ReadAsync(const std::string& file, uint64_t offset, uint64_t size, float priority)
+        {
+            auto promise = std::make_shared<std::promise<ReadResult>>();
+            std::future<ReadResult> future = promise->get_future();
+            if(!IO_Execute(priority, [promise, file, offset, size]{
+                promise->set_value(_internal_Read(file, offset, size));
+            }))
+                return {};
+            return future;
+        }
+        bool ReadAsync(const std::string& file, uint64_t offset, uint64_t size, float priority, std::function<void(ReadResult&)> callback)
+        {
+            return IO_Execute(priority, [file, offset, size, callback = std::move(callback)]{
+                ReadResult result = _internal_Read(file, offset, size);
+                callback(result);
+            });
         }
     }
 }
\ No newline at end of file
@@ -1,19 +1,53 @@
 #pragma once
 #include "stdafx.h"
 #include <filesystem>
+#include <functional>
+#include <future>
 
 namespace Game
 {
     namespace Filesystem
     {
+        // Read-only view into a memory mapped file, copies share the mapping and the last one unmaps it
+        struct FileView
+        {
+            const uint8_t* data = nullptr;
+            size_t size = 0;
+            std::shared_ptr<const void> mapping;
+
+            bool empty() const { return size == 0; }
+            FileView Slice(size_t offset, size_t count) const; // Same mapping, empty if the range is out of bounds
+        };
+
         // Register a filesystem directory before working on loading and saving a data
         void Register_FS(std::string virtualpath, std::string actualpath, bool file);
         // Use overlay for situations such as patches, DLC, and the like
         void Register_FSOverlay(std::string virtualpath, std::string actualpath, bool file);
+        // Mount a read-only pack file, its files are looked up under virtualpath without touching the OS filesystem
+        // A pack takes over loose files unless a loose overlay with a higher priority covers the same path
+        bool Register_FSPack(std::string virtualpath, std::string packfile, uint32_t priority = 0);
 
         std::string GetActualPath(const std::string& file);
         bool FileRead(const std::string& file, wi::vector<uint8_t>& data);
         bool FileWrite(const std::string& file, const uint8_t* data, size_t size);
         bool FileExists(const std::string& file);
+        bool MapFile(const std::string& file, FileView& view); // Packs first, then the loose file
+        bool MapActualFile(const std::string& actualpath, FileView& view); // Maps an OS path, skips the virtual filesystem
+        bool PackMap(const std::string& file, FileView& view); // Maps the file only if a mounted pack holds it
+        bool PackWrite(const std::string& packfile, const std::string& directory); // Packs every file under the directory
+        void Prefault(const FileView& view); // Touches every page of the view, so reading it later does not wait on the disk
+        bool IsResident(const FileView& view); // True if every page of the view is already in memory, reading it will not wait on the disk
+
+        // Async I/O runs on its own threads, so a cold disk never stalls a job worker
+        // Lower priority values go first, submitting never blocks and is refused while queue_depth requests are already waiting
+        struct ReadResult
+        {
+            bool success = false;
+            FileView view; // Already paged in
+        };
+        void IO_Configure(uint32_t thread_count, uint32_t queue_depth); // Threads are only added once running, never taken away
+        bool IO_Execute(float priority, std::function<void()> task); // Runs any blocking work on the I/O threads, false if the queue is full
+        std::future<ReadResult> ReadAsync(const std::string& file, uint64_t offset = 0, uint64_t size = ~0ull, float priority = 0.f); // Invalid future if the queue is full
+        bool ReadAsync(const std::string& file, uint64_t offset, uint64_t size, float priority, std::function<void(ReadResult&)> callback); // Callback runs on an I/O thread, false if the queue is full
     }
 }
\ No newline at end of file
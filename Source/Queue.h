@@ -0,0 +1,98 @@
+#pragma once
+#include <atomic>
+#include <memory>
+#include <cstddef>
+#include <cstdint>
+
+namespace Game{
+    // Bounded lock-free queue, any number of threads can push and pop
+    // Every cell carries a sequence number that tells whose turn it is, so neither side ever takes a lock
+    // Capacity is rounded up to a power of two, TryPush fails when the queue is full
+    template<typename T>
+    class BoundedQueue
+    {
+    public:
+        explicit BoundedQueue(size_t capacity = 1024)
+        {
+            size_t cell_count = 2;
+            while(cell_count < capacity)
+                cell_count <<= 1;
+            mask = cell_count - 1;
+            cells = std::make_unique<Cell[]>(cell_count);
+            for(size_t i = 0; i < cell_count; ++i)
+            {
+                cells[i].sequence.store(i, std::memory_order_relaxed);
+            }
+        }
+        BoundedQueue(const BoundedQueue&) = delete;
+        BoundedQueue& operator=(const BoundedQueue&) = delete;
+
+        bool TryPush(T value)
+        {
+            Cell* cell;
+            size_t pos = push_pos.load(std::memory_order_relaxed);
+            while(true)
+            {
+                cell = &cells[pos & mask];
+                size_t sequence = cell->sequence.load(std::memory_order_acquire);
+                intptr_t diff = intptr_t(sequence) - intptr_t(pos);
+                if(diff == 0)
+                {
+                    if(push_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                        break;
+                }
+                else if(diff < 0) // Full
+                    return false;
+                else
+                    pos = push_pos.load(std::memory_order_relaxed);
+            }
+            cell->data = std::move(value);
+            cell->sequence.store(pos + 1, std::memory_order_release);
+            return true;
+        }
+
+        bool TryPop(T& value)
+        {
+            Cell* cell;
+            size_t pos = pop_pos.load(std::memory_order_relaxed);
+            while(true)
+            {
+                cell = &cells[pos & mask];
+                size_t sequence = cell->sequence.load(std::memory_order_acquire);
+                intptr_t diff = intptr_t(sequence) - intptr_t(pos + 1);
+                if(diff == 0)
+                {
+                    if(pop_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                        break;
+                }
+                else if(diff < 0) // Empty
+                    return false;
+                else
+                    pos = pop_pos.load(std::memory_order_relaxed);
+            }
+            value = std::move(cell->data);
+            cell->data = T();
+            cell->sequence.store(pos + mask + 1, std::memory_order_release);
+            return true;
+        }
+
+        // Only a hint while other threads are working on the queue
+        size_t SizeApprox() const
+        {
+            size_t push = push_pos.load(std::memory_order_relaxed);
+            size_t pop = pop_pos.load(std::memory_order_relaxed);
+            return (push > pop) ? (push - pop) : 0;
+        }
+
+    private:
+        struct Cell
+        {
+            std::atomic<size_t> sequence;
+            T data;
+        };
+        std::unique_ptr<Cell[]> cells;
+        size_t mask = 0;
+        alignas(64) std::atomic<size_t> push_pos = {0};
+        alignas(64) std::atomic<size_t> pop_pos = {0};
+    };
+}
@@ -0,0 +1,81 @@
+#pragma once
+#include "stdafx.h"
+#include <algorithm>
+#include <memory>
+
+namespace Game{
+    // Entity remap of a serialized file, (serialized entity, scene entity) pairs sorted by the serialized entity
+    // Copies share the same read-only array, a table only builds a new one when its content changes
+    class RemapTable
+    {
+    public:
+        using Pair = std::pair<uint64_t, wi::ecs::Entity>;
+
+        const Pair* begin() const { return (data != nullptr) ? data->data() : nullptr; }
+        const Pair* end() const { return (data != nullptr) ? data->data() + data->size() : nullptr; }
+        size_t size() const { return (data != nullptr) ? data->size() : 0; }
+        bool empty() const { return size() == 0; }
+        void clear() { data = nullptr; }
+
+        // Returns end() if the entity is not in the table
+        const Pair* find(uint64_t entity) const
+        {
+            const Pair* first = begin();
+            const Pair* last = end();
+            const Pair* found = std::lower_bound(first, last, entity, [](const Pair& pair, uint64_t key){
+                return pair.first < key;
+            });
+            if((found != last) && (found->first == entity))
+                return found;
+            return last;
+        }
+
+        // Take over the remap that a serializer filled
+        void Assign(wi::unordered_map<uint64_t, wi::ecs::Entity>&& remap)
+        {
+            auto table = std::make_shared<wi::vector<Pair>>(remap.begin(), remap.end());
+            std::sort(table->begin(), table->end());
+            data = std::move(table);
+            remap.clear();
+        }
+
+        // Add or overwrite pairs, builds one new array for the whole list
+        void Insert(wi::vector<Pair>&& pairs)
+        {
+            if(pairs.empty())
+                return;
+            std::sort(pairs.begin(), pairs.end());
+            auto table = std::make_shared<wi::vector<Pair>>();
+            table->reserve(size() + pairs.size());
+            const Pair* old_pair = begin();
+            const Pair* old_end = end();
+            for(auto& pair : pairs)
+            {
+                while((old_pair != old_end) && (old_pair->first < pair.first))
+                    table->push_back(*old_pair++);
+                if((old_pair != old_end) && (old_pair->first == pair.first))
+                    old_pair++;
+                if(!table->empty() && (table->back().first == pair.first))
+                    table->back() = pair;
+                else
+                    table->push_back(pair);
+            }
+            while(old_pair != old_end)
+                table->push_back(*old_pair++);
+            data = std::move(table);
+        }
+
+        // Fill a serializer's remap, which the engine needs as a hash map
+        void Export(wi::unordered_map<uint64_t, wi::ecs::Entity>& remap) const
+        {
+            remap.reserve(remap.size() + size());
+            for(auto& pair : *this)
+            {
+                remap[pair.first] = pair.second;
+            }
+        }
+
+    private:
+        std::shared_ptr<const wi::vector<Pair>> data;
+    };
+}
@@ -4,6 +4,10 @@
 #include <mutex>
 #include <chrono>
 #include <algorithm>
+#include <cstring>
+#include <cmath>
+#include <thread>
+#include <fstream>
 
 namespace Game{
     Scene* GetScene(){
@@ -21,20 +25,24 @@ namespace Game{
     }
     void Scene::Prefab::Enable()
     {
+        wi::vector<wi::ecs::Entity> entities;
+        entities.reserve(remap.size());
         for(auto& map_pair : remap)
         {
-            auto& target_entity = map_pair.second;
-            GetScene()->Entity_Enable(target_entity);
+            entities.push_back(map_pair.second);
         }
+        GetScene()->Entity_EnableBatch(entities);
         disabled = false;
     }
     void Scene::Prefab::Disable()
     {
+        wi::vector<wi::ecs::Entity> entities;
+        entities.reserve(remap.size());
         for(auto& map_pair : remap)
         {
-            auto& target_entity = map_pair.second;
-            GetScene()->Entity_Disable(target_entity);
+            entities.push_back(map_pair.second);
         }
+        GetScene()->Entity_DisableBatch(entities);
         disabled = true;
     }
     void Scene::Prefab::Unload()
@@ -42,25 +50,60 @@ namespace Game{
         for(auto& map_pair : remap)
         {
             auto& target_entity = map_pair.second;
-            GetScene()->wiscene.Entity_Remove(target_entity, false);
+            GetScene()->Entity_Remove(target_entity);
         }
         loaded = false;
     }
+    Scene::Prefab::Prefab(Prefab&& other) noexcept
+    {
+        *this = std::move(other);
+    }
+    Scene::Prefab& Scene::Prefab::operator=(Prefab&& other) noexcept
+    {
+        if(this == &other)
+            return *this;
+        Release();
+
+        file = std::move(other.file);
+        copy_mode = other.copy_mode;
+        stream_mode = other.stream_mode;
+        stream_distance_multiplier = other.stream_distance_multiplier;
+        remap = std::move(other.remap);
+        entity_name_map = std::move(other.entity_name_map);
+        loaded = other.loaded;
+        disabled = other.disabled;
+        residency_time = other.residency_time;
+        preview_object = other.preview_object;
+        fade_factor = other.fade_factor;
+        fade_data = std::move(other.fade_data);
+        tostash_prefabID = other.tostash_prefabID;
+
+        // The source no longer owns anything, destroying it must not touch the scene
+        other.loaded = false;
+        other.disabled = false;
+        other.preview_object = wi::ecs::INVALID_ENTITY;
+        return *this;
+    }
     Scene::Prefab::~Prefab()
+    {
+        Release();
+    }
+    void Scene::Prefab::Release()
     {
         // Remove preview mesh from scene
         if(GetScene()->wiscene.meshes.Contains(preview_object))
         {
-            GetScene()->wiscene.Entity_Remove(preview_object, false);
+            GetScene()->Entity_Remove(preview_object);
             preview_object = wi::ecs::INVALID_ENTITY;
         }
 
         // Stash remap data away
         // GetScene()->prefab_remap_stash[tostash_prefabID] = remap;
 
-        // Remove all prefab's entities if it is still existing
-        if(loaded)
+        // Remove all prefab's entities if it is still existing, cached prefabs keep theirs disabled
+        if(loaded || disabled)
             Unload();
+        disabled = false;
     }
 
     void Scene::Component_Prefab::Serialize(wi::Archive &archive, wi::ecs::EntitySerializer &seri)
@@ -94,6 +137,243 @@ namespace Game{
         }
     }
 
+    // Streaming boundary of a prefab in world space, the archive bounds are centered and scaled by the stream multiplier
+    wi::primitive::AABB _internal_Prefab_StreamBounds(const wi::primitive::AABB& archive_bounds, float stream_distance_multiplier, const XMFLOAT4X4& prefab_world)
+    {
+        wi::primitive::AABB zone_check = archive_bounds;
+        wi::scene::TransformComponent transformator;
+
+        XMFLOAT3 zone_center = XMFLOAT3(((zone_check._max.x-zone_check._min.x)*0.5f)+zone_check._min.x,((zone_check._max.y-zone_check._min.y)*0.5f)+zone_check._min.y,((zone_check._max.z-zone_check._min.z)*0.5f)+zone_check._min.z);
+        transformator.Translate(XMFLOAT3(-zone_center.x, -zone_center.y, -zone_center.z));
+        transformator.UpdateTransform();
+        zone_check = zone_check.transform(transformator.world);
+
+        transformator = wi::scene::TransformComponent();
+        transformator.Scale(XMFLOAT3(stream_distance_multiplier, stream_distance_multiplier, stream_distance_multiplier));
+        transformator.UpdateTransform();
+        zone_check = zone_check.transform(transformator.world);
+
+        return zone_check.transform(prefab_world);
+    }
+
+    static const int32_t _internal_StreamIndex_CellRange = (1 << 20) - 1;
+    int32_t _internal_StreamIndex_Cell(float position, float cell_size)
+    {
+        float cell = std::floor(position / cell_size);
+        return (int32_t)std::max(std::min(cell, float(_internal_StreamIndex_CellRange)), -float(_internal_StreamIndex_CellRange));
+    }
+    uint64_t _internal_StreamIndex_CellKey(int32_t x, int32_t y, int32_t z)
+    {
+        // 21 bits per axis
+        return (uint64_t(uint32_t(x) & 0x1FFFFF) << 42) | (uint64_t(uint32_t(y) & 0x1FFFFF) << 21) | uint64_t(uint32_t(z) & 0x1FFFFF);
+    }
+    void Scene::StreamIndex::Insert(wi::ecs::Entity prefabID, Entry entry, const wi::primitive::AABB& world_bounds)
+    {
+        Remove(prefabID);
+
+        entry.spatial = false;
+        if((entry.stream_mode == Prefab::StreamMode::DISTANCE) && (world_bounds._min.x <= world_bounds._max.x) && (world_bounds._min.y <= world_bounds._max.y) && (world_bounds._min.z <= world_bounds._max.z))
+        {
+            entry.cell_min[0] = _internal_StreamIndex_Cell(world_bounds._min.x, cell_size);
+            entry.cell_min[1] = _internal_StreamIndex_Cell(world_bounds._min.y, cell_size);
+            entry.cell_min[2] = _internal_StreamIndex_Cell(world_bounds._min.z, cell_size);
+            entry.cell_max[0] = _internal_StreamIndex_Cell(world_bounds._max.x, cell_size);
+            entry.cell_max[1] = _internal_StreamIndex_Cell(world_bounds._max.y, cell_size);
+            entry.cell_max[2] = _internal_StreamIndex_Cell(world_bounds._max.z, cell_size);
+            uint64_t cell_count = 
+                uint64_t(entry.cell_max[0] - entry.cell_min[0] + 1) *
+                uint64_t(entry.cell_max[1] - entry.cell_min[1] + 1) *
+                uint64_t(entry.cell_max[2] - entry.cell_min[2] + 1);
+            entry.spatial = (cell_count <= cell_limit);
+        }
+
+        if(entry.spatial)
+        {
+            for(int32_t x = entry.cell_min[0]; x <= entry.cell_max[0]; ++x)
+                for(int32_t y = entry.cell_min[1]; y <= entry.cell_max[1]; ++y)
+                    for(int32_t z = entry.cell_min[2]; z <= entry.cell_max[2]; ++z)
+                        cells[_internal_StreamIndex_CellKey(x, y, z)].push_back(prefabID);
+        }
+        else
+            nonspatial.insert(prefabID);
+
+        entry.slot = (uint32_t)bounds.entity.size();
+        bounds.min_x.push_back(world_bounds._min.x);
+        bounds.min_y.push_back(world_bounds._min.y);
+        bounds.min_z.push_back(world_bounds._min.z);
+        bounds.max_x.push_back(world_bounds._max.x);
+        bounds.max_y.push_back(world_bounds._max.y);
+        bounds.max_z.push_back(world_bounds._max.z);
+        bounds.radius.push_back(world_bounds.getRadius());
+        bounds.entity.push_back(prefabID);
+
+        files[entry.file].push_back(prefabID);
+        entries[prefabID] = std::move(entry);
+    }
+    void Scene::StreamIndex::Remove(wi::ecs::Entity prefabID)
+    {
+        auto find_entry = entries.find(prefabID);
+        if(find_entry == entries.end())
+            return;
+
+        const Entry& entry = find_entry->second;
+        if(entry.spatial)
+        {
+            for(int32_t x = entry.cell_min[0]; x <= entry.cell_max[0]; ++x)
+                for(int32_t y = entry.cell_min[1]; y <= entry.cell_max[1]; ++y)
+                    for(int32_t z = entry.cell_min[2]; z <= entry.cell_max[2]; ++z)
+                    {
+                        auto find_cell = cells.find(_internal_StreamIndex_CellKey(x, y, z));
+                        if(find_cell == cells.end())
+                            continue;
+                        auto& cell = find_cell->second;
+                        auto find_prefab = std::find(cell.begin(), cell.end(), prefabID);
+                        if(find_prefab != cell.end())
+                        {
+                            *find_prefab = cell.back();
+                            cell.pop_back();
+                        }
+                        if(cell.empty())
+                            cells.erase(find_cell);
+                    }
+        }
+        else
+            nonspatial.erase(prefabID);
+
+        // Swap the last cached bounds into the freed slot
+        uint32_t slot = entry.slot;
+        uint32_t last = (uint32_t)bounds.entity.size() - 1;
+        if(slot != last)
+        {
+            bounds.min_x[slot] = bounds.min_x[last];
+            bounds.min_y[slot] = bounds.min_y[last];
+            bounds.min_z[slot] = bounds.min_z[last];
+            bounds.max_x[slot] = bounds.max_x[last];
+            bounds.max_y[slot] = bounds.max_y[last];
+            bounds.max_z[slot] = bounds.max_z[last];
+            bounds.radius[slot] = bounds.radius[last];
+            bounds.entity[slot] = bounds.entity[last];
+            entries[bounds.entity[slot]].slot = slot;
+        }
+        bounds.min_x.pop_back();
+        bounds.min_y.pop_back();
+        bounds.min_z.pop_back();
+        bounds.max_x.pop_back();
+        bounds.max_y.pop_back();
+        bounds.max_z.pop_back();
+        bounds.radius.pop_back();
+        bounds.entity.pop_back();
+
+        auto find_file = files.find(entry.file);
+        if(find_file != files.end())
+        {
+            auto& file_prefabs = find_file->second;
+            auto find_prefab = std::find(file_prefabs.begin(), file_prefabs.end(), prefabID);
+            if(find_prefab != file_prefabs.end())
+            {
+                *find_prefab = file_prefabs.back();
+                file_prefabs.pop_back();
+            }
+            if(file_prefabs.empty())
+                files.erase(find_file);
+        }
+
+        active.erase(prefabID);
+        entries.erase(find_entry);
+    }
+    void Scene::StreamIndex::MarkArchive(const std::string& file)
+    {
+        auto find_file = files.find(file);
+        if(find_file == files.end())
+            return;
+        dirty.insert(find_file->second.begin(), find_file->second.end());
+    }
+    void Scene::StreamIndex::Query(const XMFLOAT4& sphere, wi::vector<wi::ecs::Entity>& result) const
+    {
+        int32_t cell_min[3] = {
+            _internal_StreamIndex_Cell(sphere.x - sphere.w, cell_size),
+            _internal_StreamIndex_Cell(sphere.y - sphere.w, cell_size),
+            _internal_StreamIndex_Cell(sphere.z - sphere.w, cell_size)
+        };
+        int32_t cell_max[3] = {
+            _internal_StreamIndex_Cell(sphere.x + sphere.w, cell_size),
+            _internal_StreamIndex_Cell(sphere.y + sphere.w, cell_size),
+            _internal_StreamIndex_Cell(sphere.z + sphere.w, cell_size)
+        };
+        uint64_t cell_count = 
+            uint64_t(cell_max[0] - cell_min[0] + 1) *
+            uint64_t(cell_max[1] - cell_min[1] + 1) *
+            uint64_t(cell_max[2] - cell_min[2] + 1);
+
+        if(cell_count > cells.size()) // Huge loader, cheaper to walk the occupied cells
+        {
+            for(auto& cell_pair : cells)
+            {
+                result.insert(result.end(), cell_pair.second.begin(), cell_pair.second.end());
+            }
+            return;
+        }
+
+        for(int32_t x = cell_min[0]; x <= cell_max[0]; ++x)
+            for(int32_t y = cell_min[1]; y <= cell_max[1]; ++y)
+                for(int32_t z = cell_min[2]; z <= cell_max[2]; ++z)
+                {
+                    auto find_cell = cells.find(_internal_StreamIndex_CellKey(x, y, z));
+                    if(find_cell != cells.end())
+                        result.insert(result.end(), find_cell->second.begin(), find_cell->second.end());
+                }
+    }
+
+    void Scene::StreamIndex::DistanceBatch(const wi::vector<uint32_t>& slots, const XMFLOAT3& point, float* box_distance_sq, float* center_distance_sq) const
+    {
+        const XMVECTOR point_x = XMVectorReplicate(point.x);
+        const XMVECTOR point_y = XMVectorReplicate(point.y);
+        const XMVECTOR point_z = XMVectorReplicate(point.z);
+        const XMVECTOR half = XMVectorReplicate(0.5f);
+
+        size_t i = 0;
+        for(; i + 4 <= slots.size(); i += 4)
+        {
+            const uint32_t s0 = slots[i], s1 = slots[i+1], s2 = slots[i+2], s3 = slots[i+3];
+            const XMVECTOR min_x = XMVectorSet(bounds.min_x[s0], bounds.min_x[s1], bounds.min_x[s2], bounds.min_x[s3]);
+            const XMVECTOR min_y = XMVectorSet(bounds.min_y[s0], bounds.min_y[s1], bounds.min_y[s2], bounds.min_y[s3]);
+            const XMVECTOR min_z = XMVectorSet(bounds.min_z[s0], bounds.min_z[s1], bounds.min_z[s2], bounds.min_z[s3]);
+            const XMVECTOR max_x = XMVectorSet(bounds.max_x[s0], bounds.max_x[s1], bounds.max_x[s2], bounds.max_x[s3]);
+            const XMVECTOR max_y = XMVectorSet(bounds.max_y[s0], bounds.max_y[s1], bounds.max_y[s2], bounds.max_y[s3]);
+            const XMVECTOR max_z = XMVectorSet(bounds.max_z[s0], bounds.max_z[s1], bounds.max_z[s2], bounds.max_z[s3]);
+
+            // Closest point inside the box
+            const XMVECTOR box_x = XMVectorSubtract(XMVectorMin(XMVectorMax(point_x, min_x), max_x), point_x);
+            const XMVECTOR box_y = XMVectorSubtract(XMVectorMin(XMVectorMax(point_y, min_y), max_y), point_y);
+            const XMVECTOR box_z = XMVectorSubtract(XMVectorMin(XMVectorMax(point_z, min_z), max_z), point_z);
+            const XMVECTOR box = XMVectorMultiplyAdd(box_x, box_x, XMVectorMultiplyAdd(box_y, box_y, XMVectorMultiply(box_z, box_z)));
+
+            // Box center
+            const XMVECTOR center_x = XMVectorSubtract(XMVectorMultiply(XMVectorAdd(min_x, max_x), half), point_x);
+            const XMVECTOR center_y = XMVectorSubtract(XMVectorMultiply(XMVectorAdd(min_y, max_y), half), point_y);
+            const XMVECTOR center_z = XMVectorSubtract(XMVectorMultiply(XMVectorAdd(min_z, max_z), half), point_z);
+            const XMVECTOR center = XMVectorMultiplyAdd(center_x, center_x, XMVectorMultiplyAdd(center_y, center_y, XMVectorMultiply(center_z, center_z)));
+
+            XMFLOAT4 result;
+            XMStoreFloat4(&result, box);
+            std::memcpy(box_distance_sq + i, &result, sizeof(result));
+            XMStoreFloat4(&result, center);
+            std::memcpy(center_distance_sq + i, &result, sizeof(result));
+        }
+        for(; i < slots.size(); ++i)
+        {
+            const uint32_t slot = slots[i];
+            float box_x = std::min(std::max(point.x, bounds.min_x[slot]), bounds.max_x[slot]) - point.x;
+            float box_y = std::min(std::max(point.y, bounds.min_y[slot]), bounds.max_y[slot]) - point.y;
+            float box_z = std::min(std::max(point.z, bounds.min_z[slot]), bounds.max_z[slot]) - point.z;
+            box_distance_sq[i] = box_x * box_x + box_y * box_y + box_z * box_z;
+            float center_x = (bounds.min_x[slot] + bounds.max_x[slot]) * 0.5f - point.x;
+            float center_y = (bounds.min_y[slot] + bounds.max_y[slot]) * 0.5f - point.y;
+            float center_z = (bounds.min_z[slot] + bounds.max_z[slot]) * 0.5f - point.z;
+            center_distance_sq[i] = center_x * center_x + center_y * center_y + center_z * center_z;
+        }
+    }
+
     std::shared_ptr<Scene::StreamJob> GetStreamJobData() // Pointer to stream job
     {
         static std::shared_ptr<Scene::StreamJob> stream_data = std::make_shared<Scene::StreamJob>();
@@ -242,94 +522,630 @@ namespace Game{
     }
 
     wi::jobsystem::context stream_job;
-    std::mutex stream_mutex;
 
-    void _internal_Clone_Prefab(Scene::Archive& archive, wi::ecs::Entity clone_prefabID)
+    // Jump positions from the head of a disabled entity's inactive storage, one per fallback_plan step
+    void _internal_Read_Jumps(wi::Archive& archive, size_t count, wi::vector<size_t>& component_jump_list)
     {
-        Scene::Prefab* find_clone_prefab = GetScene()->prefabs.GetComponent(clone_prefabID);
-        Scene::Prefab* find_prefab = GetScene()->prefabs.GetComponent(archive.prefabID);
-        if(find_clone_prefab != nullptr)
+        component_jump_list.resize(count);
+        for(auto& jump : component_jump_list)
         {
-            // Check if there is a stashed remap data
+            archive >> jump;
+        }
+    }
 
-            wi::ecs::EntitySerializer seri;
-            if(find_clone_prefab->copy_mode == Scene::Prefab::CopyMode::DEEP_COPY)
+    // Inactive slabs are packed with a zero run length encoding, serialized components are mostly zeros
+    // A control byte below 128 is followed by control + 1 literal bytes, from 128 up it stands for control - 127 zeros
+    void _internal_Pack_Zeros(const wi::vector<uint8_t>& raw, wi::vector<uint8_t>& packed)
+    {
+        packed.clear();
+        packed.reserve(raw.size() / 2);
+        size_t i = 0;
+        while(i < raw.size())
+        {
+            bool zero = (raw[i] == 0);
+            size_t run = 1;
+            while((i + run < raw.size()) && ((raw[i + run] == 0) == zero) && (run < 128))
+                run++;
+            if(zero)
+                packed.push_back(uint8_t(127 + run));
+            else
+            {
+                packed.push_back(uint8_t(run - 1));
+                packed.insert(packed.end(), raw.begin() + i, raw.begin() + i + run);
+            }
+            i += run;
+        }
+        packed.shrink_to_fit();
+    }
+    void _internal_Unpack_Zeros(const wi::vector<uint8_t>& packed, uint64_t raw_size, wi::vector<uint8_t>& raw)
+    {
+        raw.clear();
+        raw.reserve(raw_size);
+        size_t i = 0;
+        while(i < packed.size())
+        {
+            uint8_t control = packed[i++];
+            if(control < 128)
+            {
+                size_t run = std::min(size_t(control) + 1, packed.size() - i);
+                raw.insert(raw.end(), packed.begin() + i, packed.begin() + i + run);
+                i += run;
+            }
+            else
+                raw.resize(raw.size() + (control - 127), 0);
+        }
+    }
+
+    wi::jobsystem::context inactive_compress_ctx;
+
+    // Unpacks the slab if it was compressed, main thread only, so jobs can read the storage after it
+    void _internal_Inactive_Prepare(const Scene::Inactive& inactive)
+    {
+        Scene::InactiveSlab* slab = inactive.slab.get();
+        if(slab == nullptr)
+            return;
+        if(slab->compressing.load(std::memory_order_acquire))
+            wi::jobsystem::Wait(inactive_compress_ctx);
+        slab->idle_time = 0;
+        if(!slab->compressed)
+            return;
+        wi::vector<uint8_t> raw;
+        _internal_Unpack_Zeros(slab->data, slab->raw_size, raw);
+        slab->data = std::move(raw);
+        slab->compressed = false;
+    }
+    // Storage of a prepared entity, nullptr if nothing was serialized for it
+    const uint8_t* _internal_Inactive_Storage(const Scene::Inactive& inactive)
+    {
+        if((inactive.slab == nullptr) || (inactive.size == 0))
+            return nullptr;
+        return inactive.slab->data.data() + inactive.offset;
+    }
+    // Compress the slabs that weren't touched for a while, in the background
+    void _internal_Run_Inactive_Compression(Scene& scene, float dt)
+    {
+        size_t alive_count = 0;
+        for(size_t i = 0; i < scene.inactive_slabs.size(); ++i)
+        {
+            std::shared_ptr<Scene::InactiveSlab> slab = scene.inactive_slabs[i].lock();
+            if(slab == nullptr)
+                continue;
+            scene.inactive_slabs[alive_count++] = scene.inactive_slabs[i];
+            // The job owns the fields until it clears compressing, so that has to be checked first
+            if(slab->compressing.load(std::memory_order_acquire) || slab->compressed)
+                continue;
+            slab->idle_time += dt;
+            if((scene.inactive_compress_time <= 0.f) || (slab->idle_time < scene.inactive_compress_time))
+                continue;
+            slab->compressing.store(true);
+            wi::jobsystem::Execute(inactive_compress_ctx, [slab](wi::jobsystem::JobArgs args){
+                wi::vector<uint8_t> packed;
+                _internal_Pack_Zeros(slab->data, packed);
+                if(packed.size() < slab->data.size())
+                {
+                    slab->raw_size = slab->data.size();
+                    slab->data = std::move(packed);
+                    slab->compressed = true;
+                }
+                else
+                    slab->idle_time = 0; // Not worth it, try again later
+                slab->compressing.store(false, std::memory_order_release);
+            });
+        }
+        scene.inactive_slabs.resize(alive_count);
+    }
+    // Clone the archive's entities into every prefab of the list
+    // Shallow copies share everything but the entities themselves, so they clone one component manager per job for all prefabs at once
+    // Deep copies create new entities for references as they go and clone one entity at a time
+    void _internal_Clone_Prefabs(Scene::Archive& archive, const wi::vector<wi::ecs::Entity>& clone_prefabIDs)
+    {
+        Scene* scene = GetScene();
+
+        // Sort the source entities parent first, so the clones get their hierarchy components in order
+        wi::vector<wi::ecs::Entity> source_entities;
+        source_entities.reserve(archive.remap.size());
+        for(auto& map_pair : archive.remap)
+        {
+            source_entities.push_back(map_pair.second);
+        }
+        wi::unordered_set<wi::ecs::Entity> source_set(source_entities.begin(), source_entities.end());
+        wi::unordered_map<wi::ecs::Entity, uint32_t> source_depth;
+        for(auto& entity : source_entities)
+        {
+            uint32_t depth = 0;
+            wi::scene::HierarchyComponent* hierarchy = scene->wiscene.hierarchy.GetComponent(entity);
+            while((hierarchy != nullptr) && (source_set.find(hierarchy->parentID) != source_set.end()) && (depth < source_entities.size()))
+            {
+                depth++;
+                hierarchy = scene->wiscene.hierarchy.GetComponent(hierarchy->parentID);
+            }
+            source_depth[entity] = depth;
+        }
+        std::stable_sort(source_entities.begin(), source_entities.end(), [&source_depth](wi::ecs::Entity a, wi::ecs::Entity b){
+            return source_depth[a] < source_depth[b];
+        });
+        wi::unordered_map<wi::ecs::Entity, uint32_t> source_index;
+        for(uint32_t i = 0; i < (uint32_t)source_entities.size(); ++i)
+        {
+            source_index[source_entities[i]] = i;
+        }
+
+        // Reserve the clone entities of every prefab up front, row per prefab
+        wi::vector<wi::ecs::Entity> instances;
+        wi::vector<bool> instance_deep;
+        for(auto& clone_prefabID : clone_prefabIDs)
+        {
+            Scene::Prefab* clone_prefab = scene->prefabs.GetComponent(clone_prefabID);
+            if(clone_prefab == nullptr)
+                continue;
+            instances.push_back(clone_prefabID);
+            instance_deep.push_back(clone_prefab->copy_mode == Scene::Prefab::CopyMode::DEEP_COPY);
+        }
+        if(instances.empty())
+            return;
+        const size_t source_count = source_entities.size();
+        wi::vector<wi::ecs::Entity> clone_entities(instances.size() * source_count);
+        wi::vector<size_t> shallow_instances;
+        for(size_t n = 0; n < instances.size(); ++n)
+        {
+            Scene::Prefab* clone_prefab = scene->prefabs.GetComponent(instances[n]);
+            wi::vector<RemapTable::Pair> new_pairs;
+            for(size_t i = 0; i < source_count; ++i)
             {
-                for(auto& map_pair : archive.remap)
+                auto find_clone = clone_prefab->remap.find(source_entities[i]);
+                if(find_clone != clone_prefab->remap.end())
+                    clone_entities[n * source_count + i] = find_clone->second;
+                else
                 {
-                    auto& origin_entity = map_pair.second;
-                    if(find_clone_prefab->remap.find(origin_entity) == find_clone_prefab->remap.end())
-                        find_clone_prefab->remap[origin_entity] = wi::ecs::CreateEntity();
+                    clone_entities[n * source_count + i] = wi::ecs::CreateEntity();
+                    new_pairs.push_back({source_entities[i], clone_entities[n * source_count + i]});
                 }
             }
-            for(auto& map_pair : archive.remap)
+            clone_prefab->remap.Insert(std::move(new_pairs));
+            if(!instance_deep[n])
+                shallow_instances.push_back(n);
+        }
+
+        // Deep copies, one entity at a time
+        for(size_t n = 0; n < instances.size(); ++n)
+        {
+            if(!instance_deep[n])
+                continue;
+            wi::ecs::EntitySerializer seri;
+            wi::unordered_map<uint64_t, wi::ecs::Entity> clone_remap;
+            scene->prefabs.GetComponent(instances[n])->remap.Export(clone_remap);
+            for(auto& origin_entity : source_entities)
             {
-                auto& origin_entity = map_pair.second;
-                auto clone_entity = GetScene()->Entity_Clone(origin_entity, seri, (find_clone_prefab->copy_mode == Scene::Prefab::CopyMode::DEEP_COPY) ? true : false, &(find_clone_prefab->remap));
+                scene->Entity_Clone(origin_entity, seri, true, &clone_remap);
             }
             wi::jobsystem::Wait(seri.ctx);
+            scene->prefabs.GetComponent(instances[n])->remap.Assign(std::move(clone_remap));
+        }
+
+        // Shallow copies, a job per component manager, each source component is read once for all prefabs
+        if(!shallow_instances.empty())
+        {
+            for(auto& entity : source_entities)
+            {
+                const Scene::Component_Inactive* inactive = scene->inactives.GetComponent(entity);
+                if(inactive != nullptr)
+                    _internal_Inactive_Prepare(*inactive);
+            }
+            wi::jobsystem::context clone_ctx;
+            for(auto& step : scene->shallow_clone_plan.steps)
+            {
+                const Scene::ComponentPlan::Step* plan_step = &step;
+                wi::jobsystem::Execute(clone_ctx, [scene, plan_step, source_count, &source_entities, &clone_entities, &shallow_instances](wi::jobsystem::JobArgs args){
+                    wi::ecs::EntitySerializer seri;
+                    seri.allow_remap = false;
+                    seri.version = plan_step->version;
+                    wi::vector<size_t> component_jump_list;
+                    for(size_t i = 0; i < source_count; ++i)
+                    {
+                        wi::ecs::Entity entity = source_entities[i];
+                        const Scene::Component_Inactive* inactive = scene->inactives.GetComponent(entity);
+                        auto compmgr = plan_step->component_manager;
+                        // Disabled components are read from the cold store, the clones get them as active
+                        if((inactive != nullptr) && (plan_step->cold != nullptr) && plan_step->cold->cold->Contains(entity))
+                            compmgr = plan_step->cold->cold;
+                        if(plan_step->copy != nullptr)
+                        {
+                            for(auto& n : shallow_instances)
+                            {
+                                plan_step->copy->Copy(*compmgr, entity, clone_entities[n * source_count + i], seri);
+                            }
+                            continue;
+                        }
+                        const uint8_t* inactive_storage = (inactive != nullptr) ? _internal_Inactive_Storage(*inactive) : nullptr;
+                        if((inactive_storage != nullptr) && (plan_step->fallback_slot != ~0u))
+                        {
+                            for(auto& n : shallow_instances)
+                            {
+                                wi::Archive ar_enable = wi::Archive(inactive_storage);
+                                ar_enable.SetReadModeAndResetPos(true);
+                                _internal_Read_Jumps(ar_enable, plan_step->fallback_slot + 1, component_jump_list);
+                                ar_enable.Jump(component_jump_list[plan_step->fallback_slot]);
+                                plan_step->component_manager->Component_Serialize(clone_entities[n * source_count + i], ar_enable, seri);
+                            }
+                            continue;
+                        }
+                        if(!compmgr->Contains(entity))
+                            continue;
+                        wi::Archive ar_copy;
+                        ar_copy.SetReadModeAndResetPos(false);
+                        compmgr->Component_Serialize(entity, ar_copy, seri);
+                        wi::jobsystem::Wait(seri.ctx);
+                        for(auto& n : shallow_instances)
+                        {
+                            ar_copy.SetReadModeAndResetPos(true);
+                            plan_step->component_manager->Component_Serialize(clone_entities[n * source_count + i], ar_copy, seri);
+                        }
+                    }
+                    wi::jobsystem::Wait(seri.ctx);
+                });
+            }
+            wi::jobsystem::Wait(clone_ctx);
+        }
 
-            // Remap parenting for shallow copy
-            for(auto& map_pair : find_clone_prefab->remap)
+        // Remap parenting for all prefabs in one batch
+        wi::vector<std::pair<wi::ecs::Entity, wi::ecs::Entity>> attach_list;
+        attach_list.reserve(clone_entities.size());
+        for(size_t i = 0; i < source_count; ++i)
+        {
+            wi::scene::HierarchyComponent* original_hierarchy = scene->wiscene.hierarchy.GetComponent(source_entities[i]);
+            wi::ecs::Entity original_parent = (original_hierarchy != nullptr) ? original_hierarchy->parentID : archive.prefabID;
+            for(size_t n = 0; n < instances.size(); ++n)
             {
-                // If it has no parent then we attach them to prefab
-                wi::scene::HierarchyComponent* original_hierarchy = GetScene()->wiscene.hierarchy.GetComponent(map_pair.first);
-                wi::scene::HierarchyComponent* hierarchy = GetScene()->wiscene.hierarchy.GetComponent(map_pair.second);
-                if((original_hierarchy != nullptr) && (hierarchy != nullptr))
+                wi::ecs::Entity clone_prefabID = instances[n];
+                wi::ecs::Entity clone_entity = clone_entities[n * source_count + i];
+                wi::ecs::Entity parent = clone_prefabID; // If it has no parent then we attach them to prefab
+                if((original_parent != archive.prefabID) && scene->wiscene.hierarchy.Contains(clone_entity))
                 {
-                    if(original_hierarchy->parentID == archive.prefabID)
-                        GetScene()->wiscene.Component_Attach(map_pair.second, clone_prefabID, true);
+                    auto find_parent = source_index.find(original_parent);
+                    if(find_parent != source_index.end())
+                        parent = clone_entities[n * source_count + find_parent->second];
                     else
-                        GetScene()->wiscene.Component_Attach(map_pair.second, find_clone_prefab->remap[original_hierarchy->parentID], true);
+                    {
+                        Scene::Prefab* clone_prefab = scene->prefabs.GetComponent(clone_prefabID);
+                        auto find_remap = clone_prefab->remap.find(original_parent);
+                        if(find_remap != clone_prefab->remap.end())
+                            parent = find_remap->second;
+                    }
                 }
-                else
-                    GetScene()->wiscene.Component_Attach(map_pair.second, clone_prefabID, true);
+                attach_list.push_back({clone_entity, parent});
             }
+        }
+        scene->Component_AttachBatch(attach_list);
+        scene->presence.SetBatch(clone_entities, Scene::PresenceIndex::State::ALIVE);
 
-            // Clone object fade data
-            if(find_prefab != nullptr)
+        // Clone object fade data, prefab pointers are taken now that the clones stopped adding components
+        Scene::Prefab* find_prefab = scene->prefabs.GetComponent(archive.prefabID);
+        wi::vector<Scene::Prefab*> clone_prefabs(instances.size());
+        for(size_t n = 0; n < instances.size(); ++n)
+        {
+            clone_prefabs[n] = scene->prefabs.GetComponent(instances[n]);
+            clone_prefabs[n]->loaded = true;
+        }
+        if(find_prefab != nullptr)
+        {
+            const size_t fade_count = find_prefab->fade_data.size();
+            for(auto& clone_prefab : clone_prefabs)
             {
-                wi::jobsystem::context fade_data_ctx;
-                if(find_clone_prefab->fade_data.size() < find_prefab->fade_data.size())
-                    find_clone_prefab->fade_data.resize(find_prefab->fade_data.size());
-                wi::jobsystem::Dispatch(fade_data_ctx, uint32_t(find_prefab->fade_data.size()), 255, [find_clone_prefab, find_prefab](wi::jobsystem::JobArgs jobArgs){
-                    auto& fade_pair = find_prefab->fade_data[jobArgs.jobIndex];
-                    wi::ecs::Entity object_remapped = find_clone_prefab->remap[fade_pair.first];
-                    find_clone_prefab->fade_data[jobArgs.jobIndex] = {object_remapped, fade_pair.second};
-                    // Set clone object's initial fade
-                    wi::scene::ObjectComponent* object = GetScene()->wiscene.objects.GetComponent(object_remapped);
-                    if(object != nullptr)
-                        object->color.w = 0.f;
-                });
-                wi::jobsystem::Wait(fade_data_ctx);
+                if(clone_prefab->fade_data.size() < fade_count)
+                    clone_prefab->fade_data.resize(fade_count);
             }
+            wi::jobsystem::context fade_data_ctx;
+            wi::jobsystem::Dispatch(fade_data_ctx, uint32_t(fade_count * clone_prefabs.size()), 255, [scene, fade_count, find_prefab, &clone_prefabs](wi::jobsystem::JobArgs jobArgs){
+                Scene::Prefab* clone_prefab = clone_prefabs[jobArgs.jobIndex / fade_count];
+                size_t fade_index = jobArgs.jobIndex % fade_count;
+                auto& fade_pair = find_prefab->fade_data[fade_index];
+                auto find_object = clone_prefab->remap.find(fade_pair.first);
+                wi::ecs::Entity object_remapped = (find_object != clone_prefab->remap.end()) ? find_object->second : wi::ecs::INVALID_ENTITY;
+                clone_prefab->fade_data[fade_index] = {object_remapped, fade_pair.second};
+                // Set clone object's initial fade
+                wi::scene::ObjectComponent* object = scene->wiscene.objects.GetComponent(object_remapped);
+                if(object != nullptr)
+                    object->color.w = 0.f;
+            });
+            wi::jobsystem::Wait(fade_data_ctx);
+        }
+    }
+    bool Scene::Bundle::ReadHeader(const std::string& file)
+    {
+        valid = false;
+        std::ifstream bundle_stream(file, std::ios::binary | std::ios::ate);
+        if(!bundle_stream.is_open())
+            return false;
+        uint64_t file_size = uint64_t(bundle_stream.tellg());
+        bundle_stream.seekg(0);
+
+        uint32_t header[4] = {}; // magic, version, section count, reserved
+        if(!bundle_stream.read((char*)header, sizeof(header)))
+            return false;
+        if((header[0] != MAGIC) || (header[1] != VERSION) || (header[2] < uint32_t(Section::COUNT)))
+            return false;
+        if(!bundle_stream.read((char*)sections, sizeof(sections)))
+            return false;
+        for(auto& section : sections)
+        {
+            if((section.offset > file_size) || (section.size > (file_size - section.offset)))
+                return false;
+        }
+        valid = true;
+        return true;
+    }
+    bool Scene::Bundle::MapSection(const std::string& file, Section section, Filesystem::FileView& view) const
+    {
+        if(!valid)
+            return false;
+        const Range& range = sections[size_t(section)];
+        if(range.size == 0)
+            return false;
+        Filesystem::FileView bundle_view;
+        if(!Filesystem::MapActualFile(file, bundle_view))
+            return false;
+        view = bundle_view.Slice(size_t(range.offset), size_t(range.size));
+        return !view.empty();
+    }
+    bool Scene::Bundle::Write(const std::string& file, const wi::vector<uint8_t> (&section_data)[size_t(Section::COUNT)])
+    {
+        std::ofstream bundle_stream(file, std::ios::binary | std::ios::trunc);
+        if(!bundle_stream.is_open())
+            return false;
+
+        uint32_t header[4] = {MAGIC, VERSION, uint32_t(Section::COUNT), 0};
+        Range ranges[size_t(Section::COUNT)];
+        uint64_t offset = sizeof(header) + sizeof(ranges);
+        for(size_t i = 0; i < size_t(Section::COUNT); ++i)
+        {
+            ranges[i].offset = offset;
+            ranges[i].size = section_data[i].size();
+            offset += ranges[i].size;
+        }
+        bundle_stream.write((const char*)header, sizeof(header));
+        bundle_stream.write((const char*)ranges, sizeof(ranges));
+        for(size_t i = 0; i < size_t(Section::COUNT); ++i)
+        {
+            bundle_stream.write((const char*)section_data[i].data(), std::streamsize(section_data[i].size()));
+        }
+        return bool(bundle_stream);
+    }
 
-            find_clone_prefab->loaded = true;
+    // Gets the stream data ready to deserialize, runs on the stream worker
+    // Bundle sections, pack entries and loose files are all mapped into section_view, nothing is copied to the heap
+    // INIT also picks up the bounds here, and drops the bundle path if there is no usable bundle
+    bool _internal_Stream_Read(Scene::StreamData& stream_data, Filesystem::FileView& section_view)
+    {
+        switch(stream_data.stream_type)
+        {
+            case Scene::StreamData::StreamType::INIT:
+            {
+                if(!stream_data.bundle_file.empty() && stream_data.bundle.ReadHeader(stream_data.bundle_file))
+                {
+                    Filesystem::FileView bounds_view;
+                    if(stream_data.bundle.MapSection(stream_data.bundle_file, Scene::Bundle::Section::BOUNDS, bounds_view))
+                    {
+                        wi::ecs::EntitySerializer seri;
+                        wi::Archive ar_bounds = wi::Archive(bounds_view.data);
+                        ar_bounds.SetReadModeAndResetPos(true);
+                        stream_data.bounds.Serialize(ar_bounds, seri);
+                        stream_data.has_bounds = true;
+                    }
+                    return stream_data.bundle.MapSection(stream_data.bundle_file, Scene::Bundle::Section::PREVIEW, section_view);
+                }
+                stream_data.bundle_file.clear();
+
+                Filesystem::FileView bounds_view;
+                std::string bounds_file = wi::helper::ReplaceExtension(stream_data.actual_file, "bounds");
+                if(Filesystem::PackMap(wi::helper::ReplaceExtension(stream_data.file, "bounds"), bounds_view) && !bounds_view.empty())
+                {
+                    wi::ecs::EntitySerializer seri;
+                    wi::Archive ar_bounds = wi::Archive(bounds_view.data);
+                    ar_bounds.SetReadModeAndResetPos(true);
+                    stream_data.bounds.Serialize(ar_bounds, seri);
+                    stream_data.has_bounds = true;
+                }
+                else if(wi::helper::FileExists(bounds_file))
+                {
+                    wi::ecs::EntitySerializer seri;
+                    wi::Archive ar_bounds = wi::Archive(bounds_file);
+                    stream_data.bounds.Serialize(ar_bounds, seri);
+                    stream_data.has_bounds = true;
+                }
+                if(Filesystem::PackMap(wi::helper::ReplaceExtension(stream_data.file, "preview"), section_view) && !section_view.empty())
+                    return true;
+                return Filesystem::MapActualFile(stream_data.actual_file, section_view) && !section_view.empty();
+            }
+            case Scene::StreamData::StreamType::FULL:
+            {
+                if(!stream_data.bundle_file.empty())
+                    return stream_data.bundle.MapSection(stream_data.bundle_file, Scene::Bundle::Section::SCENE, section_view);
+                if(Filesystem::PackMap(stream_data.file, section_view) && !section_view.empty())
+                    return true;
+                return Filesystem::MapActualFile(stream_data.actual_file, section_view) && !section_view.empty();
+            }
         }
+        return false;
     }
-    wi::vector<std::shared_ptr<Scene::StreamData>> stream_callbacks;
-    void _internal_Run_Stream_Job(std::shared_ptr<Scene::StreamJob> stream_job_data)
+
+    // Hands a request to the stream workers, if the queue is full it waits for the scheduler instead of holding up this thread
+    void _internal_Stream_Queue_Push(Scene::StreamJob& stream_job_data, const std::shared_ptr<Scene::StreamData>& stream_data_ptr)
     {
-        wi::jobsystem::Execute(stream_job, [stream_job_data](wi::jobsystem::JobArgs jobargs){
-            size_t it = 0;
-            size_t it_end = 0;
-            it_end = stream_job_data->stream_queue.size();
-            while(it < it_end)
+        if(stream_job_data.stream_queue.TryPush(stream_data_ptr))
+            return;
+        std::scoped_lock overflow_lock(stream_job_data.overflow_mutex);
+        stream_job_data.stream_queue_overflow.push_back(stream_data_ptr);
+    }
+    void _internal_Stream_Callback_Push(Scene::StreamJob& stream_job_data, const std::shared_ptr<Scene::StreamData>& stream_data_ptr)
+    {
+        if(stream_job_data.stream_callbacks.TryPush(stream_data_ptr))
+            return;
+        std::scoped_lock overflow_lock(stream_job_data.overflow_mutex);
+        stream_job_data.stream_callbacks_overflow.push_back(stream_data_ptr);
+    }
+
+    // Reads the request on the I/O threads and hands it to the stream workers once the data is paged in
+    // Job workers only ever deserialize, the disk waits stay on the I/O threads
+    // Returns false if the I/O queue is full, the request stays with the caller
+    bool _internal_Run_Stream_Read(std::shared_ptr<Scene::StreamJob> stream_job_data, std::shared_ptr<Scene::StreamData> stream_data_ptr)
+    {
+        stream_job_data->stream_read_active.fetch_add(1);
+        bool queued = Filesystem::IO_Execute(stream_data_ptr->priority, [stream_job_data, stream_data_ptr]{
+            stream_data_ptr->stream_ready = _internal_Stream_Read(*stream_data_ptr, stream_data_ptr->section_view);
+            if(stream_data_ptr->stream_ready)
+                Filesystem::Prefault(stream_data_ptr->section_view);
+
+            _internal_Stream_Queue_Push(*stream_job_data, stream_data_ptr);
+            stream_job_data->stream_read_active.fetch_sub(1);
+        });
+        if(!queued)
+            stream_job_data->stream_read_active.fetch_sub(1);
+        return queued;
+    }
+
+    // Memory archives have no directory to resolve relative texture names against, so the engine can't load them while deserializing
+    // The textures that did not load are listed here and read through the mounts, which also finds the ones that only exist in a pack
+    void _internal_List_Textures(Scene::StreamData& stream_data)
+    {
+        wi::scene::Scene& scene = stream_data.block->wiscene;
+        std::string directory = wi::helper::GetDirectoryFromPath(stream_data.file);
+        for(size_t i = 0; i < scene.materials.GetCount(); ++i)
+        {
+            wi::scene::MaterialComponent& material = scene.materials[i];
+            for(int j = 0; j < wi::scene::MaterialComponent::TEXTURESLOT_COUNT; ++j)
+            {
+                auto& texture = material.textures[j];
+                if(texture.name.empty() || texture.resource.IsValid())
+                    continue;
+                Scene::StreamData::TextureRead& texture_read = stream_data.texture_reads.emplace_back();
+                texture_read.materialID = scene.materials.GetEntity(i);
+                texture_read.slot = j;
+                texture_read.file = directory + texture.name;
+            }
+        }
+    }
+    // The texture reads go back to the I/O threads, the stream worker that picks the request up again only decodes
+    void _internal_Run_Texture_Read(std::shared_ptr<Scene::StreamJob> stream_job_data, std::shared_ptr<Scene::StreamData> stream_data_ptr)
+    {
+        stream_job_data->stream_read_active.fetch_add(1);
+        bool queued = Filesystem::IO_Execute(stream_data_ptr->priority, [stream_job_data, stream_data_ptr]{
+            for(auto& texture_read : stream_data_ptr->texture_reads)
             {
-                bool return_callback = false;
+                if(Filesystem::PackMap(texture_read.file, texture_read.view) && !texture_read.view.empty())
+                    Filesystem::Prefault(texture_read.view);
+                else
+                    Filesystem::FileRead(texture_read.file, texture_read.data);
+            }
+            stream_data_ptr->texture_ready = true;
+
+            _internal_Stream_Queue_Push(*stream_job_data, stream_data_ptr);
+            stream_job_data->stream_read_active.fetch_sub(1);
+        });
+        if(!queued)
+        {
+            stream_job_data->stream_read_active.fetch_sub(1);
+            std::scoped_lock overflow_lock(stream_job_data->overflow_mutex);
+            stream_job_data->stream_queue_overflow.push_back(stream_data_ptr);
+        }
+    }
+    void _internal_Load_Textures(Scene::StreamData& stream_data)
+    {
+        wi::scene::Scene& scene = stream_data.block->wiscene;
+        for(auto& texture_read : stream_data.texture_reads)
+        {
+            wi::scene::MaterialComponent* material = scene.materials.GetComponent(texture_read.materialID);
+            if(material == nullptr)
+                continue;
+            auto& texture = material->textures[texture_read.slot];
+            if(!texture_read.view.empty())
+                texture.resource = wi::resourcemanager::Load(texture_read.file, wi::resourcemanager::Flags::NONE, texture_read.view.data, texture_read.view.size);
+            else if(!texture_read.data.empty())
+                texture.resource = wi::resourcemanager::Load(texture_read.file, wi::resourcemanager::Flags::NONE, texture_read.data.data(), texture_read.data.size());
+        }
+        stream_data.texture_reads.clear();
+    }
 
-                auto stream_data_ptr = stream_job_data->stream_queue.at(it);
+    // Estimated memory of a scene, the component arrays plus the mesh and animation data that they own
+    template<typename T>
+    uint64_t _internal_Manager_Bytes(const wi::ecs::ComponentManager<T>& manager)
+    {
+        return uint64_t(manager.GetCount()) * (sizeof(T) + sizeof(wi::ecs::Entity));
+    }
+    template<typename T>
+    uint64_t _internal_Vector_Bytes(const wi::vector<T>& data)
+    {
+        return uint64_t(data.size()) * sizeof(T);
+    }
+    uint64_t _internal_Scene_Bytes(const wi::scene::Scene& scene)
+    {
+        uint64_t bytes = 0;
+        bytes += _internal_Manager_Bytes(scene.names) + _internal_Manager_Bytes(scene.layers) + _internal_Manager_Bytes(scene.transforms);
+        bytes += _internal_Manager_Bytes(scene.hierarchy) + _internal_Manager_Bytes(scene.materials) + _internal_Manager_Bytes(scene.meshes);
+        bytes += _internal_Manager_Bytes(scene.impostors) + _internal_Manager_Bytes(scene.objects) + _internal_Manager_Bytes(scene.rigidbodies);
+        bytes += _internal_Manager_Bytes(scene.softbodies) + _internal_Manager_Bytes(scene.armatures) + _internal_Manager_Bytes(scene.lights);
+        bytes += _internal_Manager_Bytes(scene.cameras) + _internal_Manager_Bytes(scene.probes) + _internal_Manager_Bytes(scene.forces);
+        bytes += _internal_Manager_Bytes(scene.decals) + _internal_Manager_Bytes(scene.animations) + _internal_Manager_Bytes(scene.animation_datas);
+        bytes += _internal_Manager_Bytes(scene.emitters) + _internal_Manager_Bytes(scene.hairs) + _internal_Manager_Bytes(scene.weathers);
+        bytes += _internal_Manager_Bytes(scene.sounds) + _internal_Manager_Bytes(scene.inverse_kinematics) + _internal_Manager_Bytes(scene.springs);
+        bytes += _internal_Manager_Bytes(scene.colliders) + _internal_Manager_Bytes(scene.scripts) + _internal_Manager_Bytes(scene.expressions);
+        bytes += _internal_Manager_Bytes(scene.humanoids) + _internal_Manager_Bytes(scene.terrains);
+        for(size_t i = 0; i < scene.meshes.GetCount(); ++i)
+        {
+            const wi::scene::MeshComponent& mesh = scene.meshes[i];
+            bytes += _internal_Vector_Bytes(mesh.vertex_positions) + _internal_Vector_Bytes(mesh.vertex_normals) + _internal_Vector_Bytes(mesh.vertex_tangents);
+            bytes += _internal_Vector_Bytes(mesh.vertex_uvset_0) + _internal_Vector_Bytes(mesh.vertex_uvset_1) + _internal_Vector_Bytes(mesh.vertex_colors);
+            bytes += _internal_Vector_Bytes(mesh.vertex_boneindices) + _internal_Vector_Bytes(mesh.vertex_boneweights) + _internal_Vector_Bytes(mesh.vertex_windweights);
+            bytes += _internal_Vector_Bytes(mesh.indices);
+        }
+        for(size_t i = 0; i < scene.animation_datas.GetCount(); ++i)
+        {
+            const wi::scene::AnimationDataComponent& animation_data = scene.animation_datas[i];
+            bytes += _internal_Vector_Bytes(animation_data.keyframe_times) + _internal_Vector_Bytes(animation_data.keyframe_data);
+        }
+        return bytes;
+    }
 
-                if(stream_data_ptr->stream_type == Scene::StreamData::StreamType::INIT)
-                    return_callback = true;
+    // Spawns one stream worker, the worker keeps taking requests until the queue runs dry
+    // A request that slips in right as the worker leaves is picked up by the worker spawned on the next frame
+    void _internal_Run_Stream_Job(std::shared_ptr<Scene::StreamJob> stream_job_data)
+    {
+        stream_job_data->stream_worker_active.fetch_add(1);
+        wi::jobsystem::Execute(stream_job, [stream_job_data](wi::jobsystem::JobArgs jobargs){
+            while(true)
+            {
+                std::shared_ptr<Scene::StreamData> stream_data_ptr;
+                if(!stream_job_data->stream_queue.TryPop(stream_data_ptr))
+                {
+                    stream_job_data->stream_worker_active.fetch_sub(1);
+                    break;
+                }
+                if(stream_data_ptr->texture_ready)
+                {
+                    // Back from the texture reads, the block was deserialized on an earlier pass
+                    _internal_Load_Textures(*stream_data_ptr);
+                    _internal_Stream_Callback_Push(*stream_job_data, stream_data_ptr);
+                    continue;
+                }
+                stream_data_ptr->wait_time = float(stream_data_ptr->request_timer.elapsed_milliseconds());
 
-                if(wi::helper::FileExists(stream_data_ptr->actual_file))
+                Filesystem::FileView stream_section_view = std::move(stream_data_ptr->section_view); // Has to outlive the archive, memory archives don't copy
+                stream_data_ptr->section_view = {};
+                if(stream_data_ptr->stream_ready)
                 {
                     wi::ecs::EntitySerializer seri;
-                    seri.remap = stream_data_ptr->remap;
+                    stream_data_ptr->remap.Export(seri.remap);
+
+                    // Each request deserializes into its own block, so workers never share a scene
+                    if(GetStreamJobData()->block_pool.TryPop(stream_data_ptr->block))
+                        GetStreamJobData()->block_pool_hit_count++;
+                    else
+                    {
+                        stream_data_ptr->block = std::make_shared<Scene>();
+                        GetStreamJobData()->block_pool_miss_count++;
+                    }
 
-                    stream_data_ptr->block = std::make_shared<Scene>();
-                    auto ar_stream = wi::Archive(stream_data_ptr->actual_file);
+                    auto ar_stream = wi::Archive(stream_section_view.data);
+                    ar_stream.SetReadModeAndResetPos(true);
 
                     switch(stream_data_ptr->stream_type)
                     {
@@ -354,119 +1170,392 @@ namespace Game{
                             if (stream_data_ptr->is_prefab)
                             {
                                 wi::jobsystem::context enlist_ctx;
+                                stream_data_ptr->fade_data.resize(stream_data_ptr->block->wiscene.objects.GetCount());
                                 wi::jobsystem::Dispatch(enlist_ctx, stream_data_ptr->block->wiscene.objects.GetCount(), 255, [stream_data_ptr](wi::jobsystem::JobArgs jobArgs){
                                     auto objectID = stream_data_ptr->block->wiscene.objects.GetEntity(jobArgs.jobIndex);
                                     wi::scene::ObjectComponent& object = stream_data_ptr->block->wiscene.objects[jobArgs.jobIndex];
 
-                                    stream_data_ptr->fade_data.push_back({objectID,object.color.w});
+                                    stream_data_ptr->fade_data[jobArgs.jobIndex] = {objectID,object.color.w};
                                     object.color.w = 0.f;
                                 });
                                 wi::jobsystem::Wait(enlist_ctx);
                             }
-
-                            return_callback = true;
                             break;
                         }
                     }
 
-                    stream_data_ptr->remap = seri.remap;
-                }
-
-                std::scoped_lock scene_sync(stream_mutex);
+                    stream_data_ptr->resident_bytes = _internal_Scene_Bytes(stream_data_ptr->block->wiscene);
+                    stream_data_ptr->remap.Assign(std::move(seri.remap));
 
-                if(return_callback)
-                    stream_callbacks.push_back(stream_data_ptr);
+                    _internal_List_Textures(*stream_data_ptr);
+                    if(!stream_data_ptr->texture_reads.empty())
+                    {
+                        _internal_Run_Texture_Read(stream_job_data, stream_data_ptr);
+                        continue;
+                    }
+                }
 
-                it++;
-                it_end = stream_job_data->stream_queue.size();
+                // Every request reports back, even a failed one, otherwise the requests after it would never finish
+                _internal_Stream_Callback_Push(*stream_job_data, stream_data_ptr);
             }
-            stream_job_data->stream_queue.clear();
         });
     }
-    void _internal_Finish_Stream(std::shared_ptr<Scene::StreamData> stream_callback)
+    // Finishes a streamed block in small steps, returns true once the block is fully in the scene
+    // Keeps working until the budget runs out, but always makes at least one step of progress
+    void _internal_Finish_Merge_Component(Scene::StreamData& stream_data, const std::string& component_name)
+    {
+        auto& block_entries = stream_data.block->wiscene.componentLibrary.entries;
+        auto find_block_entry = block_entries.find(component_name);
+        if(find_block_entry != block_entries.end())
+            GetScene()->wiscene.componentLibrary.entries[component_name].component_manager->Merge(*find_block_entry->second.component_manager);
+    }
+    // Merged in the attach step no matter what the disable plans say, their systems act on them the moment they are live
+    // Prefabs would be indexed and streamed at unparented positions, scripts of a library would start before it is disabled
+    const wi::vector<std::string> finish_attach_list = {
+        "wi::scene::Scene::transforms",
+        "wi::scene::Scene::hierarchy",
+        "Game::Scene::Prefab",
+        "Game::Scene::Script",
+    };
+    bool _internal_Finish_Stream(std::shared_ptr<Scene::StreamData> stream_callback, wi::Timer& finish_timer, float finish_budget_ms)
     {
         Scene::Archive& archive = GetScene()->scene_db[stream_callback->file];
+        using FinishStep = Scene::StreamData::FinishStep;
+
+        if(stream_callback->finish_step == FinishStep::BEGIN)
+        {
+            Scene::StreamStats& stream_stats = GetScene()->stream_stats;
+            if(stream_stats.finished_count == 0)
+                stream_stats.wait_time_avg = stream_callback->wait_time;
+            else
+                stream_stats.wait_time_avg += (stream_callback->wait_time - stream_stats.wait_time_avg) * 0.1f;
+            stream_stats.wait_time_max = std::max(stream_stats.wait_time_max, stream_callback->wait_time);
+            stream_stats.finished_count++;
+        }
+
         switch(stream_callback->stream_type)
         {
             case Scene::StreamData::StreamType::INIT:
             {
+                if(stream_callback->has_bounds)
+                {
+                    archive.bounds = stream_callback->bounds;
+                    archive.bounds_version++;
+                }
+                archive.bundle_file = stream_callback->bundle_file;
+                archive.bundle = stream_callback->bundle;
                 if(stream_callback->block != nullptr)
                 {
                     GetScene()->wiscene.Merge(stream_callback->block->wiscene);
                     archive.previewID = stream_callback->clone_prefabID;
                     archive.preview_transform = stream_callback->preview_transform;
                 }
+                GetScene()->stream_index.MarkArchive(archive.file); // New bounds and preview for every prefab of the archive
                 archive.load_state = Scene::Archive::LoadState::UNLOADED;
+                stream_callback->finish_step = FinishStep::DONE;
                 break;
             }
             case Scene::StreamData::StreamType::FULL:
             {
-                archive.remap = stream_callback->remap;
+                if(stream_callback->prefetch)
+                {
+                    // Keep it aside until the prefab comes into range, unless the prefetch was dropped meanwhile
+                    stream_callback->staged = (archive.prefetch_data == stream_callback);
+                    stream_callback->finish_step = FinishStep::DONE;
+                    break;
+                }
 
-                GetScene()->wiscene.Merge(stream_callback->block->wiscene);
+                if(stream_callback->block == nullptr)
+                {
+                    wi::backlog::post("Failed to stream " + stream_callback->actual_file, wi::backlog::LogLevel::Error);
+                    archive.load_state = Scene::Archive::LoadState::FAILED; // Otherwise it would wait on this stream forever
+                    stream_callback->finish_step = FinishStep::DONE;
+                    break;
+                }
 
-                // Work on the prefab too if it exists
-                Scene::Prefab* find_prefab = GetScene()->prefabs.GetComponent(archive.prefabID);
-                if(find_prefab != nullptr)
+                do
                 {
-                    find_prefab->remap = archive.remap;
-                    // Need to parent components to the scene
-                    for(auto& map_pair : find_prefab->remap)
+                    switch(stream_callback->finish_step)
                     {
-                        // If it has no parent then we attach them to prefab
-                        bool set_parent = false;
-                        wi::scene::HierarchyComponent* hierarchy = GetScene()->wiscene.hierarchy.GetComponent(map_pair.second);
-                        if(hierarchy != nullptr)
+                        case FinishStep::BEGIN:
                         {
-                            if(hierarchy->parentID == wi::ecs::INVALID_ENTITY)
-                                set_parent = true;
+                            archive.remap = stream_callback->remap;
+                            // Plain data can be merged over several frames, it does nothing on its own
+                            // The components that the disable plans cover are held back, so the block never shows up unparented
+                            wi::vector<std::string> deferred_components;
+                            for(auto& entry : GetScene()->wiscene.componentLibrary.entries)
+                            {
+                                auto is_step = [&entry](const Scene::ComponentPlan::Step& step){ return step.component_manager == entry.second.component_manager.get(); };
+                                if((std::find(finish_attach_list.begin(), finish_attach_list.end(), entry.first) != finish_attach_list.end()) ||
+                                    std::any_of(GetScene()->cold_plan.steps.begin(), GetScene()->cold_plan.steps.end(), is_step) ||
+                                    std::any_of(GetScene()->fallback_plan.steps.begin(), GetScene()->fallback_plan.steps.end(), is_step))
+                                    deferred_components.push_back(entry.first);
+                                else
+                                    stream_callback->finish_components.push_back(entry.first);
+                            }
+                            stream_callback->finish_deferred = stream_callback->finish_components.size();
+                            stream_callback->finish_components.insert(stream_callback->finish_components.end(), deferred_components.begin(), deferred_components.end());
+                            stream_callback->finish_cursor = 0;
+                            stream_callback->finish_step = FinishStep::MERGE;
+                            break;
                         }
-                        else
-                            set_parent = true;
-                        if(set_parent)
-                            GetScene()->wiscene.Component_Attach(map_pair.second, archive.prefabID, true);
-
-                        // If prefab is a library then we need to disable the entity
-                        if(find_prefab->copy_mode == Scene::Prefab::CopyMode::LIBRARY)
+                        case FinishStep::MERGE:
                         {
-                            auto& target_entity = map_pair.second;
-                            GetScene()->Entity_Disable(target_entity);
-                            find_prefab->disabled = true;
+                            // Same as Scene::Merge, but one component manager at a time
+                            if(stream_callback->finish_cursor < stream_callback->finish_deferred)
+                            {
+                                _internal_Finish_Merge_Component(*stream_callback, stream_callback->finish_components[stream_callback->finish_cursor]);
+                                stream_callback->finish_cursor++;
+                                break;
+                            }
+                            stream_callback->finish_step = FinishStep::ATTACH;
+                            break;
                         }
-                    }
-                    // Store fade data
-                    find_prefab->fade_data = stream_callback->fade_data;
-                    
-                    find_prefab->loaded = true;
-                }
+                        case FinishStep::ATTACH:
+                        {
+                            // The rest is merged, attached and disabled in one go, so nothing is live without its prefab parent
+                            for(; stream_callback->finish_cursor < stream_callback->finish_components.size(); ++stream_callback->finish_cursor)
+                            {
+                                _internal_Finish_Merge_Component(*stream_callback, stream_callback->finish_components[stream_callback->finish_cursor]);
+                            }
+                            GetScene()->wiscene.bounds = wi::primitive::AABB::Merge(GetScene()->wiscene.bounds, stream_callback->block->wiscene.bounds);
+                            archive.resident_bytes = stream_callback->resident_bytes;
+
+                            Scene::Prefab* find_prefab = GetScene()->prefabs.GetComponent(archive.prefabID);
+                            if(find_prefab != nullptr)
+                            {
+                                find_prefab->remap = archive.remap;
+                                for(auto& map_pair : find_prefab->remap)
+                                {
+                                    stream_callback->finish_entities.push_back(map_pair.second);
+                                }
+
+                                // Need to parent components to the scene, all of them in one batch
+                                wi::vector<std::pair<wi::ecs::Entity, wi::ecs::Entity>> attach_list;
+                                for(auto& target_entity : stream_callback->finish_entities)
+                                {
+                                    // If it has no parent then we attach them to prefab
+                                    wi::scene::HierarchyComponent* hierarchy = GetScene()->wiscene.hierarchy.GetComponent(target_entity);
+                                    if((hierarchy == nullptr) || (hierarchy->parentID == wi::ecs::INVALID_ENTITY))
+                                        attach_list.push_back({target_entity, archive.prefabID});
+                                }
+                                GetScene()->Component_AttachBatch(attach_list);
+                                GetScene()->presence.SetBatch(stream_callback->finish_entities, Scene::PresenceIndex::State::ALIVE);
+
+                                // If prefab is a library then we need to disable the entities right away
+                                if(find_prefab->copy_mode == Scene::Prefab::CopyMode::LIBRARY)
+                                {
+                                    GetScene()->Entity_DisableBatch(stream_callback->finish_entities);
+                                    find_prefab->disabled = true;
+                                }
+                            }
 
-                archive.load_state = Scene::Archive::LoadState::LOADED;
+                            if(find_prefab != nullptr)
+                            {
+                                // Store fade data
+                                find_prefab->fade_data = stream_callback->fade_data;
+
+                                find_prefab->loaded = true;
+                            }
+
+                            archive.load_state = Scene::Archive::LoadState::LOADED;
+                            stream_callback->finish_step = FinishStep::DONE;
+                            break;
+                        }
+                        default:
+                            break;
+                    }
+                } while((stream_callback->finish_step != FinishStep::DONE) && (finish_timer.elapsed_milliseconds() < finish_budget_ms));
                 break;
             }
         }
+
+        // Merged blocks go back to the pool, the component managers are emptied but keep their memory
+        if((stream_callback->finish_step == FinishStep::DONE) && !stream_callback->staged && (stream_callback->block != nullptr))
+        {
+            std::shared_ptr<Scene> block = std::move(stream_callback->block);
+            block->wiscene.Clear();
+            block->wiscene.bounds = wi::primitive::AABB();
+            GetStreamJobData()->block_pool.TryPush(std::move(block)); // Dropped if the pool is full
+        }
+
+        return (stream_callback->finish_step == FinishStep::DONE);
     }
-    void Scene::Archive::Init()
+    // Reorder pending requests by their current demand and hand the most urgent ones to the stream worker
+    // Prefab requests that nobody asked for this frame are dropped before they touch the disk
+    // Prefetch requests live as long as the predicted path still crosses their prefab
+    void _internal_Schedule_Stream(const wi::unordered_map<std::string, float>& stream_demand, const wi::unordered_map<std::string, float>& prefetch_demand)
     {
-        // Add data to stream job
-        GetStreamJobData()->stream_queue.push_back(std::make_shared<StreamData>());
-        StreamData* stream_data_init = GetStreamJobData()->stream_queue.back().get();
-        stream_data_init->stream_type = StreamData::StreamType::INIT;
-        stream_data_init->file = file;
-        stream_data_init->actual_file = Filesystem::GetActualPath(wi::helper::ReplaceExtension(file, "preview"));
-        stream_data_init->clone_prefabID = previewID;
+        auto stream_job_data = GetStreamJobData();
+        auto& stream_pending = stream_job_data->stream_pending;
+        Scene::StreamStats& stream_stats = GetScene()->stream_stats;
 
-        // Load boundary first, since it is small and predictable
+        for(auto& stream_data : stream_pending)
         {
-            wi::ecs::EntitySerializer seri;
-            wi::Archive ar_bounds = wi::Archive(wi::helper::ReplaceExtension(stream_data_init->actual_file, "bounds"));
-            bounds.Serialize(ar_bounds, seri);
+            if((stream_data->stream_type != Scene::StreamData::StreamType::FULL) || (!stream_data->is_prefab))
+                continue;
+
+            if(stream_data->prefetch)
+            {
+                Scene::Archive& archive = GetScene()->scene_db[stream_data->file];
+                auto find_prefetch_demand = prefetch_demand.find(stream_data->file);
+                if((archive.prefetch_data == stream_data) && (find_prefetch_demand != prefetch_demand.end()))
+                    stream_data->priority = find_prefetch_demand->second;
+                else
+                {
+                    if(archive.prefetch_data == stream_data)
+                        archive.prefetch_data = nullptr;
+                    stream_data = nullptr;
+                    stream_stats.prefetch_dropped_count++;
+                }
+                continue;
+            }
+
+            auto find_demand = stream_demand.find(stream_data->file);
+            if(find_demand != stream_demand.end())
+                stream_data->priority = find_demand->second;
+            else
+            {
+                Scene::Archive& archive = GetScene()->scene_db[stream_data->file];
+                if(archive.load_state == Scene::Archive::LoadState::LOADING)
+                    archive.load_state = Scene::Archive::LoadState::UNLOADED;
+                stream_data = nullptr;
+                stream_stats.cancelled_count++;
+            }
+        }
+        stream_pending.erase(std::remove(stream_pending.begin(), stream_pending.end(), nullptr), stream_pending.end());
+
+        // Drop staged prefetches that are off the path now, in flight ones get dropped once they are staged
+        for(auto it = stream_job_data->stream_prefetch.begin(); it != stream_job_data->stream_prefetch.end();)
+        {
+            Scene::Archive& archive = GetScene()->scene_db[*it];
+            if((archive.prefetch_data == nullptr) || (!archive.prefetch_data->prefetch))
+            {
+                it = stream_job_data->stream_prefetch.erase(it);
+                continue;
+            }
+            if(archive.prefetch_data->staged && (prefetch_demand.find(*it) == prefetch_demand.end()))
+            {
+                archive.prefetch_data = nullptr;
+                stream_stats.prefetch_dropped_count++;
+                it = stream_job_data->stream_prefetch.erase(it);
+                continue;
+            }
+            ++it;
+        }
+
+        // Prefetches always go after the prefabs that are already in range
+        std::stable_sort(stream_pending.begin(), stream_pending.end(), [](const std::shared_ptr<Scene::StreamData>& a, const std::shared_ptr<Scene::StreamData>& b){
+            if(a->prefetch != b->prefetch)
+                return b->prefetch;
+            return a->priority < b->priority;
+        });
+
+        // Requests that found a full queue on the way are handed on from here, the thread that had them moved on
+        wi::vector<std::shared_ptr<Scene::StreamData>> stream_overflow;
+        {
+            std::scoped_lock overflow_lock(stream_job_data->overflow_mutex);
+            std::swap(stream_overflow, stream_job_data->stream_queue_overflow);
+        }
+        for(auto& stream_data : stream_overflow)
+        {
+            if(!stream_data->texture_ready && !stream_data->texture_reads.empty())
+                _internal_Run_Texture_Read(stream_job_data, stream_data);
+            else
+                _internal_Stream_Queue_Push(*stream_job_data, stream_data);
+        }
+        size_t stream_overflow_count = 0;
+        {
+            std::scoped_lock overflow_lock(stream_job_data->overflow_mutex);
+            stream_overflow_count = stream_job_data->stream_queue_overflow.size();
         }
 
-        // Stream preview data
-        if(!wi::jobsystem::IsBusy(stream_job))
+        // Requests held by the workers are either still reading on the I/O threads or waiting in the queue to deserialize
+        // Reads are throttled here rather than on the I/O threads, so the threads are never parked waiting for a slot
+        size_t stream_pending_taken = 0;
+        size_t stream_ready_count = stream_job_data->stream_queue.SizeApprox() + stream_overflow_count;
+        size_t stream_read_count = stream_job_data->stream_read_active.load();
+        size_t stream_queue_count = stream_ready_count + stream_read_count;
+        while((stream_pending_taken < stream_pending.size()) && (stream_queue_count < GetScene()->stream_schedule_limit) && (stream_read_count < std::max(GetScene()->stream_read_limit, 1u)))
         {
-            _internal_Run_Stream_Job(GetStreamJobData());
+            auto& stream_data = stream_pending[stream_pending_taken];
+            stream_data->sequence = stream_job_data->submit_sequence;
+            if(!_internal_Run_Stream_Read(stream_job_data, stream_data))
+                break; // I/O queue is full, the rest stays pending until next frame
+            stream_job_data->submit_sequence++;
+            stream_pending_taken++;
+            stream_read_count++;
+            stream_queue_count++;
         }
+        stream_stats.queue_count = uint32_t(stream_queue_count);
+        stream_stats.block_pool_hit_count = stream_job_data->block_pool_hit_count.load();
+        stream_stats.block_pool_miss_count = stream_job_data->block_pool_miss_count.load();
+
+        // Spawn more workers if there is more work than running workers
+        uint32_t stream_worker_count = std::max(GetScene()->stream_worker_count, 1u);
+        uint32_t stream_worker_active = stream_job_data->stream_worker_active.load();
+        size_t stream_worker_spawn = std::min(size_t(stream_worker_count - std::min(stream_worker_active, stream_worker_count)), stream_ready_count);
+        for(size_t i = 0; i < stream_worker_spawn; ++i)
+        {
+            _internal_Run_Stream_Job(stream_job_data);
+        }
+        stream_pending.erase(stream_pending.begin(), stream_pending.begin() + stream_pending_taken);
+        stream_stats.pending_count = uint32_t(stream_pending.size());
+    }
+    // Drops cached archives, least recently visible first, until the loaded archives fit in the memory budget
+    void _internal_Run_Residency()
+    {
+        Scene* scene = GetScene();
+        uint64_t resident_bytes = 0;
+        wi::vector<std::pair<uint64_t, Scene::Archive*>> evictable_list;
+        for(auto& archive_pair : scene->scene_db)
+        {
+            Scene::Archive& archive = archive_pair.second;
+            if(archive.load_state != Scene::Archive::LoadState::LOADED)
+                continue;
+            resident_bytes += archive.resident_bytes;
+            if(archive.cached && (archive.dependency_count == 0))
+                evictable_list.push_back({archive.last_visible_frame, &archive});
+        }
+
+        if(resident_bytes > scene->stream_memory_budget)
+        {
+            std::sort(evictable_list.begin(), evictable_list.end(), [](const std::pair<uint64_t, Scene::Archive*>& a, const std::pair<uint64_t, Scene::Archive*>& b){
+                return a.first < b.first;
+            });
+            for(auto& evictable_pair : evictable_list)
+            {
+                if(resident_bytes <= scene->stream_memory_budget)
+                    break;
+
+                Scene::Archive& archive = *evictable_pair.second;
+                Scene::Prefab* prefab = scene->prefabs.GetComponent(archive.prefabID);
+                if(prefab != nullptr)
+                {
+                    prefab->Unload();
+                    prefab->disabled = false;
+                }
+                archive.load_state = Scene::Archive::LoadState::UNLOADED;
+                archive.cached = false;
+                archive.evicted = true;
+                resident_bytes -= std::min(resident_bytes, archive.resident_bytes);
+                archive.resident_bytes = 0;
+                scene->stream_stats.evicted_count++;
+            }
+        }
+        scene->stream_stats.resident_bytes = resident_bytes;
+    }
+    void Scene::Archive::Init()
+    {
+        // Add data to stream job, INIT data is small and everything else waits on it so it goes first
+        GetStreamJobData()->stream_pending.push_back(std::make_shared<StreamData>());
+        StreamData* stream_data_init = GetStreamJobData()->stream_pending.back().get();
+        stream_data_init->priority = -1.f;
+        stream_data_init->stream_type = StreamData::StreamType::INIT;
+        stream_data_init->file = file;
+        stream_data_init->actual_file = Filesystem::GetActualPath(wi::helper::ReplaceExtension(file, "preview"));
+        stream_data_init->bundle_file = Filesystem::GetActualPath(wi::helper::ReplaceExtension(file, "bundle"));
+        stream_data_init->clone_prefabID = previewID;
     }
     void Scene::Archive::Load(wi::ecs::Entity clone_prefabID)
     {
@@ -476,30 +1565,40 @@ namespace Game{
 
             // Check if there is a stashed remap data
 
-            // Add data to stream job
-            GetStreamJobData()->stream_queue.push_back(std::make_shared<StreamData>());
-            StreamData* stream_data_init = GetStreamJobData()->stream_queue.back().get();
-            stream_data_init->stream_type = StreamData::StreamType::FULL;
-            stream_data_init->file = file;
-            stream_data_init->actual_file = Filesystem::GetActualPath(file);
-            wi::backlog::post(stream_data_init->actual_file);
-            stream_data_init->remap = remap;
-            stream_data_init->is_prefab = (prefabID != wi::ecs::INVALID_ENTITY);
-
-            auto stream_job_data = GetStreamJobData();
-
-            //re-run stream job if the job does not exist
-            if(!wi::jobsystem::IsBusy(stream_job))
+            // Take over the prefetch if it was made for the same prefab, otherwise it gets dropped by the scheduler
+            std::shared_ptr<StreamData> prefetched = prefetch_data;
+            prefetch_data = nullptr;
+            if((prefetched != nullptr) && (prefetched->prefabID == prefabID))
+            {
+                prefetched->prefetch = false;
+                if(prefetched->staged) // Already streamed, only the finish is left
+                {
+                    prefetched->staged = false;
+                    prefetched->finish_step = StreamData::FinishStep::BEGIN;
+                    prefetched->sequence = GetStreamJobData()->submit_sequence++;
+                    GetStreamJobData()->stream_reorder.push_back(prefetched);
+                }
+                GetScene()->stream_stats.prefetch_hit_count++;
+            }
+            else
             {
-                _internal_Run_Stream_Job(GetStreamJobData());
+                // Add data to stream job, the scheduler picks it up on the next prefab update
+                GetStreamJobData()->stream_pending.push_back(std::make_shared<StreamData>());
+                StreamData* stream_data_init = GetStreamJobData()->stream_pending.back().get();
+                stream_data_init->stream_type = StreamData::StreamType::FULL;
+                stream_data_init->file = file;
+                stream_data_init->actual_file = Filesystem::GetActualPath(file);
+                wi::backlog::post(stream_data_init->actual_file);
+                stream_data_init->bundle_file = bundle_file;
+                stream_data_init->bundle = bundle;
+                stream_data_init->remap = remap;
+                stream_data_init->is_prefab = (prefabID != wi::ecs::INVALID_ENTITY);
+                stream_data_init->prefabID = prefabID;
             }
         }
 
         if((clone_prefabID != wi::ecs::INVALID_ENTITY) && (load_state == LoadState::LOADED))
-        {
-            dependency_count++;
-            _internal_Clone_Prefab(*this, clone_prefabID);
-        }
+            Instance({clone_prefabID});
 
         if((clone_prefabID == wi::ecs::INVALID_ENTITY) && (load_state == LoadState::LOADED)) // Re-enable prefab
         {
@@ -508,9 +1607,41 @@ namespace Game{
             {
                 if(prefab->disabled)
                     prefab->Enable();
+                prefab->loaded = true;
             }
+            cached = false;
         }
     }
+    void Scene::Archive::Instance(const wi::vector<wi::ecs::Entity>& clone_prefabIDs)
+    {
+        if((load_state != LoadState::LOADED) || clone_prefabIDs.empty())
+            return;
+        cached = false;
+        dependency_count += uint32_t(clone_prefabIDs.size());
+        _internal_Clone_Prefabs(*this, clone_prefabIDs);
+    }
+    void Scene::Archive::Prefetch(float priority)
+    {
+        if((load_state != LoadState::UNLOADED) || (prefetch_data != nullptr))
+            return;
+
+        prefetch_data = std::make_shared<StreamData>();
+        prefetch_data->stream_type = StreamData::StreamType::FULL;
+        prefetch_data->file = file;
+        prefetch_data->actual_file = Filesystem::GetActualPath(file);
+        prefetch_data->bundle_file = bundle_file;
+        prefetch_data->bundle = bundle;
+        prefetch_data->remap = remap;
+        prefetch_data->is_prefab = true;
+        prefetch_data->prefabID = prefabID;
+        prefetch_data->prefetch = true;
+        prefetch_data->priority = priority;
+
+        auto stream_job_data = GetStreamJobData();
+        stream_job_data->stream_pending.push_back(prefetch_data);
+        stream_job_data->stream_prefetch.insert(file);
+        GetScene()->stream_stats.prefetch_count++;
+    }
     void Scene::Archive::Unload(wi::ecs::Entity clone_prefabID)
     {
         if(clone_prefabID != wi::ecs::INVALID_ENTITY)
@@ -522,10 +1653,10 @@ namespace Game{
                 clone_prefab->Unload();
                 dependency_count = std::max(dependency_count-1, uint32_t(0));
             }
-            if((prefab->copy_mode == Prefab::CopyMode::LIBRARY) && (dependency_count == 0))
+            if((prefab != nullptr) && (dependency_count == 0) && ((prefab->copy_mode == Prefab::CopyMode::LIBRARY) || !prefab->loaded))
             {
-                prefab->Unload();
-                load_state = LoadState::UNLOADED;   
+                // Library or an owner that already went out of range stays disabled in memory, it goes away once the memory budget needs the space
+                cached = true;
             }
         }
         if(clone_prefabID == wi::ecs::INVALID_ENTITY)
@@ -533,17 +1664,14 @@ namespace Game{
             Prefab* prefab = GetScene()->prefabs.GetComponent(prefabID);
             if(prefab != nullptr)
             {
-                if(dependency_count > 0)
-                {
-                    if(!prefab->disabled) 
-                        prefab->Disable();
-                }
-                else
-                {
-                    prefab->Unload();
-                    load_state = LoadState::UNLOADED;
-                }
-                    
+                // Disable instead of removing, coming back into range only needs to re-enable
+                if(!prefab->disabled) 
+                    prefab->Disable();
+                prefab->loaded = false;
+
+                // Without clones depending on it the residency manager may evict it
+                if(dependency_count == 0)
+                    cached = true;
             }
         }
     }
@@ -643,71 +1771,419 @@ namespace Game{
         "wi::scene::Scene::terrains",
         "Game::Scene::Prefab"
     };
+    template<typename T>
+    void _internal_ColdStore_Add(Scene::ColdStore& cold_store, wi::scene::Scene& wiscene, const std::string& componentID, wi::ecs::ComponentManager<T>& live_manager)
+    {
+        cold_store.handlers[componentID] = std::make_unique<Scene::ColdStore::TypedHandler<T>>(live_manager);
+    }
+    Scene::ColdStore::ColdStore(wi::scene::Scene& wiscene)
+    {
+        _internal_ColdStore_Add(*this, wiscene, "wi::scene::Scene::impostors", wiscene.impostors);
+        _internal_ColdStore_Add(*this, wiscene, "wi::scene::Scene::objects", wiscene.objects);
+        _internal_ColdStore_Add(*this, wiscene, "wi::scene::Scene::lights", wiscene.lights);
+        _internal_ColdStore_Add(*this, wiscene, "wi::scene::Scene::cameras", wiscene.cameras);
+        _internal_ColdStore_Add(*this, wiscene, "wi::scene::Scene::probes", wiscene.probes);
+        _internal_ColdStore_Add(*this, wiscene, "wi::scene::Scene::forces", wiscene.forces);
+        _internal_ColdStore_Add(*this, wiscene, "wi::scene::Scene::decals", wiscene.decals);
+        _internal_ColdStore_Add(*this, wiscene, "wi::scene::Scene::emitters", wiscene.emitters);
+        _internal_ColdStore_Add(*this, wiscene, "wi::scene::Scene::hairs", wiscene.hairs);
+        _internal_ColdStore_Add(*this, wiscene, "wi::scene::Scene::weathers", wiscene.weathers);
+        _internal_ColdStore_Add(*this, wiscene, "wi::scene::Scene::inverse_kinematics", wiscene.inverse_kinematics);
+        _internal_ColdStore_Add(*this, wiscene, "wi::scene::Scene::springs", wiscene.springs);
+        _internal_ColdStore_Add(*this, wiscene, "wi::scene::Scene::colliders", wiscene.colliders);
+        _internal_ColdStore_Add(*this, wiscene, "wi::scene::Scene::scripts", wiscene.scripts);
+        _internal_ColdStore_Add(*this, wiscene, "wi::scene::Scene::expressions", wiscene.expressions);
+        _internal_ColdStore_Add(*this, wiscene, "wi::scene::Scene::humanoids", wiscene.humanoids);
+        // Rigidbodies, softbodies, sounds and terrains own physics bodies, voices and generator state that only go away with the component
+        // They keep going through inactive_storage so disabling them still stops them
+        for(auto& componentID : disable_filter_list)
+        {
+            if(handlers.find(componentID) == handlers.end())
+                fallback_list.push_back(componentID);
+        }
+    }
+    Scene::ColdStore::Handler* Scene::ColdStore::Find(const std::string& componentID)
+    {
+        auto find_handler = handlers.find(componentID);
+        if(find_handler == handlers.end())
+            return nullptr;
+        return find_handler->second.get();
+    }
+    void Scene::ColdStore::Remove(wi::ecs::Entity entity)
+    {
+        for(auto& handler_pair : handlers)
+        {
+            handler_pair.second->cold->Remove(entity);
+        }
+    }
+    void Scene::ColdStore::Sweep(const wi::ecs::ComponentManager_Interface& inactives, size_t limit)
+    {
+        for(auto& handler_pair : handlers)
+        {
+            Handler& handler = *handler_pair.second;
+            for(size_t checked = 0; (checked < limit) && (handler.cold->GetCount() > 0); ++checked)
+            {
+                if(handler.sweep_cursor >= handler.cold->GetCount())
+                    handler.sweep_cursor = 0;
+                wi::ecs::Entity entity = handler.cold->GetEntity(handler.sweep_cursor);
+                // Remove swaps the last component into the cursor, it is checked next
+                if(!inactives.Contains(entity))
+                    handler.cold->Remove(entity);
+                else
+                    handler.sweep_cursor++;
+            }
+        }
+    }
+    void _internal_Remap_Entity(wi::ecs::Entity& entity, wi::ecs::EntitySerializer& seri)
+    {
+        if(!seri.allow_remap || entity == wi::ecs::INVALID_ENTITY)
+            return;
+        auto find_remap = seri.remap.find(entity);
+        if(find_remap == seri.remap.end())
+        {
+            wi::ecs::Entity remapped = wi::ecs::CreateEntity();
+            seri.remap[entity] = remapped;
+            entity = remapped;
+        }
+        else
+            entity = find_remap->second;
+    }
+    void _internal_Copy_Transform(wi::scene::TransformComponent& transform, wi::ecs::EntitySerializer& seri)
+    {
+        // World is rebuilt from local like a deserialized transform, the source's world includes its parents
+        transform.SetDirty();
+        transform.UpdateTransform();
+    }
+    void _internal_Copy_Hierarchy(wi::scene::HierarchyComponent& hierarchy, wi::ecs::EntitySerializer& seri)
+    {
+        _internal_Remap_Entity(hierarchy.parentID, seri);
+    }
+    void _internal_Copy_Object(wi::scene::ObjectComponent& object, wi::ecs::EntitySerializer& seri)
+    {
+        _internal_Remap_Entity(object.meshID, seri);
+    }
+    template<typename T>
+    void _internal_ComponentCopy_Add(Scene::ComponentCopy& component_copy, const std::string& componentID, wi::ecs::ComponentManager<T>& manager, void(*remap)(T&, wi::ecs::EntitySerializer&) = nullptr)
+    {
+        component_copy.handlers[componentID] = std::make_unique<Scene::ComponentCopy::TypedHandler<T>>(manager, remap);
+    }
+    Scene::ComponentCopy::ComponentCopy(wi::scene::Scene& wiscene)
+    {
+        // Only plain data components, the ones that hold GPU, physics or audio resources are rebuilt from the archive
+        _internal_ComponentCopy_Add(*this, "wi::scene::Scene::names", wiscene.names);
+        _internal_ComponentCopy_Add(*this, "wi::scene::Scene::layers", wiscene.layers);
+        _internal_ComponentCopy_Add(*this, "wi::scene::Scene::transforms", wiscene.transforms, _internal_Copy_Transform);
+        _internal_ComponentCopy_Add(*this, "wi::scene::Scene::hierarchy", wiscene.hierarchy, _internal_Copy_Hierarchy);
+        _internal_ComponentCopy_Add(*this, "wi::scene::Scene::materials", wiscene.materials);
+        _internal_ComponentCopy_Add(*this, "wi::scene::Scene::objects", wiscene.objects, _internal_Copy_Object);
+        _internal_ComponentCopy_Add(*this, "wi::scene::Scene::lights", wiscene.lights);
+        _internal_ComponentCopy_Add(*this, "wi::scene::Scene::cameras", wiscene.cameras);
+        _internal_ComponentCopy_Add(*this, "wi::scene::Scene::forces", wiscene.forces);
+        _internal_ComponentCopy_Add(*this, "wi::scene::Scene::colliders", wiscene.colliders);
+    }
+    Scene::ComponentCopy::Handler* Scene::ComponentCopy::Find(const std::string& componentID)
+    {
+        auto find_handler = handlers.find(componentID);
+        if(find_handler == handlers.end())
+            return nullptr;
+        return find_handler->second.get();
+    }
+    Scene::PresenceIndex::State Scene::PresenceIndex::Get(wi::ecs::Entity entity) const
+    {
+        size_t word = size_t(entity) / 32;
+        if(word >= bits.size())
+            return State::UNKNOWN;
+        return State((bits[word] >> ((entity % 32) * 2)) & 3);
+    }
+    void Scene::PresenceIndex::Set(wi::ecs::Entity entity, State state)
+    {
+        size_t word = size_t(entity) / 32;
+        if(word >= bits.size())
+        {
+            if(state == State::UNKNOWN)
+                return;
+            bits.resize(std::max(word + 1, bits.size() * 2), 0);
+        }
+        uint32_t shift = (entity % 32) * 2;
+        bits[word] = (bits[word] & ~(uint64_t(3) << shift)) | (uint64_t(state) << shift);
+    }
+    void Scene::PresenceIndex::SetBatch(const wi::vector<wi::ecs::Entity>& entities, State state)
+    {
+        for(auto& entity : entities)
+        {
+            Set(entity, state);
+        }
+    }
+    void Scene::Prefab_MarkDirty(wi::ecs::Entity prefabID)
+    {
+        stream_index.dirty.insert(prefabID);
+    }
     bool Scene::Entity_Exists(wi::ecs::Entity entity)
     {
+        if(entity == wi::ecs::INVALID_ENTITY)
+            return false;
+        PresenceIndex::State state = presence.Get(entity);
+        if(state == PresenceIndex::State::REMOVED)
+            return false;
+        // Nearly every entity has a transform or a name, disabled ones keep theirs as well
+        if((state == PresenceIndex::State::ALIVE) && (wiscene.transforms.Contains(entity) || wiscene.names.Contains(entity)))
+            return true;
+
+        // Not seen by the scene yet, or it may have been removed by the engine since, look through every manager
+        bool exists = false;
         for(auto& component_pair : wiscene.componentLibrary.entries)
         {
-            auto compmgr = component_pair.second.component_manager.get();
-            if(compmgr->Contains(entity))
-                return true;
+            exists = exists || component_pair.second.component_manager->Contains(entity);
         }
-        return false;
+        for(auto& handler_pair : cold_store.handlers)
+        {
+            exists = exists || handler_pair.second->cold->Contains(entity);
+        }
+        presence.Set(entity, exists ? PresenceIndex::State::ALIVE : PresenceIndex::State::UNKNOWN);
+        return exists;
     }
-    void Scene::Entity_Disable(wi::ecs::Entity entity)
+    void Scene::Entity_Remove(wi::ecs::Entity entity)
+    {
+        wiscene.Entity_Remove(entity, false);
+        cold_store.Remove(entity);
+        presence.Set(entity, PresenceIndex::State::REMOVED);
+    }
+    void _internal_Compile_Plan(Scene& scene, const wi::vector<std::string>& filter_list, Scene::ComponentPlan& plan)
+    {
+        plan.steps.clear();
+        for(auto& componentID : filter_list)
+        {
+            auto& entry = scene.wiscene.componentLibrary.entries[componentID];
+            Scene::ComponentPlan::Step step;
+            step.component_manager = entry.component_manager.get();
+            step.version = entry.version;
+            step.cold = scene.cold_store.Find(componentID);
+            step.copy = scene.component_copy.Find(componentID);
+            for(uint32_t slot = 0; slot < (uint32_t)scene.cold_store.fallback_list.size(); ++slot)
+            {
+                if(scene.cold_store.fallback_list[slot] == componentID)
+                    step.fallback_slot = slot;
+            }
+            plan.steps.push_back(step);
+        }
+    }
+    Scene::Scene()
+    {
+        wi::vector<std::string> cold_list;
+        for(auto& componentID : disable_filter_list)
+        {
+            if(cold_store.Find(componentID) != nullptr)
+                cold_list.push_back(componentID);
+        }
+        _internal_Compile_Plan(*this, cold_list, cold_plan);
+        _internal_Compile_Plan(*this, cold_store.fallback_list, fallback_plan);
+        _internal_Compile_Plan(*this, full_clone_filter_list, full_clone_plan);
+        _internal_Compile_Plan(*this, shallow_clone_filter_list, shallow_clone_plan);
+    }
+    void _internal_Write_Fallback(const Scene::ComponentPlan& fallback_plan, wi::ecs::Entity entity, wi::vector<uint8_t>& inactive_storage)
     {
-        auto& inactive = inactives.Create(entity);
         wi::ecs::EntitySerializer seri;
         seri.allow_remap = false;
         auto ar_disable = wi::Archive();
         ar_disable.SetReadModeAndResetPos(false);
         // Create jump headers
-        wi::unordered_map<std::string, size_t> component_jump_list;
-        for(auto& componentID : disable_filter_list)
+        wi::vector<size_t> component_jump_list(fallback_plan.steps.size());
+        for(auto& jump : component_jump_list)
         {
-            component_jump_list[componentID] = ar_disable.WriteUnknownJumpPosition();
+            jump = ar_disable.WriteUnknownJumpPosition();
         }
         // Write actual entity data
-        for(auto& componentID : disable_filter_list)
+        for(size_t i = 0; i < fallback_plan.steps.size(); ++i)
         {
-            ar_disable.PatchUnknownJumpPosition(component_jump_list[componentID]);
-            auto compmgr = wiscene.componentLibrary.entries[componentID].component_manager.get();
-            auto& compver = wiscene.componentLibrary.entries[componentID].version;
-            seri.version = compver;
-            compmgr->Component_Serialize(entity, ar_disable, seri);
-            wi::jobsystem::Wait(seri.ctx);
-            compmgr->Remove(entity);
+            auto& step = fallback_plan.steps[i];
+            ar_disable.PatchUnknownJumpPosition(component_jump_list[i]);
+            seri.version = step.version;
+            step.component_manager->Component_Serialize(entity, ar_disable, seri);
+        }
+        wi::jobsystem::Wait(seri.ctx);
+        ar_disable.WriteData(inactive_storage);
+    }
+    void Scene::Entity_Disable(wi::ecs::Entity entity)
+    {
+        auto& inactive = inactives.Create(entity);
+        for(auto& step : cold_plan.steps)
+        {
+            step.cold->Disable(entity);
+        }
+        if(fallback_plan.steps.empty())
+            return;
+        auto slab = std::make_shared<InactiveSlab>();
+        _internal_Write_Fallback(fallback_plan, entity, slab->data);
+        inactive.slab = slab;
+        inactive.offset = 0;
+        inactive.size = slab->data.size();
+        inactive_slabs.push_back(slab);
+        for(auto& step : fallback_plan.steps)
+        {
+            step.component_manager->Remove(entity);
         }
-        ar_disable.WriteData(inactive.inactive_storage);
     }
     void Scene::Entity_Enable(wi::ecs::Entity entity)
     {
         auto inactive = inactives.GetComponent(entity);
         if(inactive != nullptr)
         {
-            wi::ecs::EntitySerializer seri;
-            seri.allow_remap = false;
-            auto ar_enable = wi::Archive(inactive->inactive_storage.data());
-            ar_enable.SetReadModeAndResetPos(true);
-            // Read jump headers
-            wi::unordered_map<std::string, size_t> component_jump_list;
-            for(auto& componentID : disable_filter_list)
+            for(auto& step : cold_plan.steps)
             {
-                size_t jump;
-                ar_enable >> jump;
-                component_jump_list[componentID] = jump;
+                step.cold->Enable(entity);
             }
-            // Write actual entity data
-            for(auto& componentID : disable_filter_list)
+            _internal_Inactive_Prepare(*inactive);
+            const uint8_t* inactive_storage = _internal_Inactive_Storage(*inactive);
+            if(inactive_storage != nullptr)
             {
-                auto compmgr = wiscene.componentLibrary.entries[componentID].component_manager.get();
-                auto& compver = wiscene.componentLibrary.entries[componentID].version;
-                seri.version = compver;
-                compmgr->Component_Serialize(entity, ar_enable, seri);
+                wi::ecs::EntitySerializer seri;
+                seri.allow_remap = false;
+                auto ar_enable = wi::Archive(inactive_storage);
+                ar_enable.SetReadModeAndResetPos(true);
+                // Skip jump headers, the components follow them in order
+                wi::vector<size_t> component_jump_list;
+                _internal_Read_Jumps(ar_enable, fallback_plan.steps.size(), component_jump_list);
+                for(auto& step : fallback_plan.steps)
+                {
+                    seri.version = step.version;
+                    step.component_manager->Component_Serialize(entity, ar_enable, seri);
+                }
+                wi::jobsystem::Wait(seri.ctx);
             }
-            wi::jobsystem::Wait(seri.ctx);
         }
         inactives.Remove(entity);
     }
+    void Scene::Entity_DisableBatch(const wi::vector<wi::ecs::Entity>& entities)
+    {
+        if(entities.empty())
+            return;
+
+        // Create all memberships first, so the storage pointers stay valid while the jobs run
+        for(auto& entity : entities)
+        {
+            inactives.Create(entity);
+        }
+        wi::vector<Component_Inactive*> inactive_list(entities.size());
+        for(size_t i = 0; i < entities.size(); ++i)
+        {
+            inactive_list[i] = inactives.GetComponent(entities[i]);
+        }
+
+        wi::jobsystem::context ctx;
+        // Each handler owns its own live and cold manager, so they can all move at once
+        for(auto& step : cold_plan.steps)
+        {
+            ColdStore::Handler* handler = step.cold;
+            wi::jobsystem::Execute(ctx, [handler, &entities](wi::jobsystem::JobArgs args){
+                for(auto& entity : entities)
+                {
+                    handler->Disable(entity);
+                }
+            });
+        }
+        // Fallback components are only read here, every entity writes its own storage
+        wi::vector<wi::vector<uint8_t>> storage_list;
+        if(!fallback_plan.steps.empty())
+        {
+            storage_list.resize(entities.size());
+            wi::jobsystem::Dispatch(ctx, (uint32_t)entities.size(), 64, [&](wi::jobsystem::JobArgs args){
+                _internal_Write_Fallback(fallback_plan, entities[args.jobIndex], storage_list[args.jobIndex]);
+            });
+        }
+        wi::jobsystem::Wait(ctx);
+
+        // All the storages go to one slab that is released once the last of these entities is enabled
+        if(!storage_list.empty())
+        {
+            size_t slab_size = 0;
+            for(auto& storage : storage_list)
+            {
+                slab_size += storage.size();
+            }
+            auto slab = std::make_shared<InactiveSlab>();
+            slab->data.reserve(slab_size);
+            for(size_t i = 0; i < entities.size(); ++i)
+            {
+                inactive_list[i]->slab = slab;
+                inactive_list[i]->offset = slab->data.size();
+                inactive_list[i]->size = storage_list[i].size();
+                slab->data.insert(slab->data.end(), storage_list[i].begin(), storage_list[i].end());
+            }
+            inactive_slabs.push_back(slab);
+        }
+
+        for(auto& step : fallback_plan.steps)
+        {
+            auto compmgr = step.component_manager;
+            wi::jobsystem::Execute(ctx, [compmgr, &entities](wi::jobsystem::JobArgs args){
+                for(auto& entity : entities)
+                {
+                    compmgr->Remove(entity);
+                }
+            });
+        }
+        wi::jobsystem::Wait(ctx);
+    }
+    void Scene::Entity_EnableBatch(const wi::vector<wi::ecs::Entity>& entities)
+    {
+        if(entities.empty())
+            return;
+
+        wi::vector<std::pair<wi::ecs::Entity, Component_Inactive*>> inactive_list;
+        inactive_list.reserve(entities.size());
+        for(auto& entity : entities)
+        {
+            auto inactive = inactives.GetComponent(entity);
+            if(inactive != nullptr)
+            {
+                _internal_Inactive_Prepare(*inactive);
+                inactive_list.push_back({entity, inactive});
+            }
+        }
+        if(inactive_list.empty())
+            return;
+
+        wi::jobsystem::context ctx;
+        for(auto& step : cold_plan.steps)
+        {
+            ColdStore::Handler* handler = step.cold;
+            wi::jobsystem::Execute(ctx, [handler, &inactive_list](wi::jobsystem::JobArgs args){
+                for(auto& inactive_pair : inactive_list)
+                {
+                    handler->Enable(inactive_pair.first);
+                }
+            });
+        }
+        // One job per fallback manager, each jumps straight to its own component in every storage
+        for(size_t i = 0; i < fallback_plan.steps.size(); ++i)
+        {
+            wi::jobsystem::Execute(ctx, [this, i, &inactive_list](wi::jobsystem::JobArgs args){
+                auto& step = fallback_plan.steps[i];
+                wi::ecs::EntitySerializer seri;
+                seri.allow_remap = false;
+                seri.version = step.version;
+                wi::vector<size_t> component_jump_list;
+                for(auto& inactive_pair : inactive_list)
+                {
+                    const uint8_t* inactive_storage = _internal_Inactive_Storage(*inactive_pair.second);
+                    if(inactive_storage == nullptr)
+                        continue;
+                    auto ar_enable = wi::Archive(inactive_storage);
+                    ar_enable.SetReadModeAndResetPos(true);
+                    _internal_Read_Jumps(ar_enable, i + 1, component_jump_list);
+                    ar_enable.Jump(component_jump_list[i]);
+                    step.component_manager->Component_Serialize(inactive_pair.first, ar_enable, seri);
+                }
+                wi::jobsystem::Wait(seri.ctx);
+            });
+        }
+        wi::jobsystem::Wait(ctx);
+
+        for(auto& inactive_pair : inactive_list)
+        {
+            inactives.Remove(inactive_pair.first);
+        }
+    }
     wi::ecs::Entity Scene::Entity_Clone(
         wi::ecs::Entity entity,
         wi::ecs::EntitySerializer& seri,
@@ -717,23 +2193,33 @@ namespace Game{
         // Clone filter'll cut out inactive and prefab from being cloned, as it poses some risk
         wi::Archive ar_copy;
 
+        // The serializer works on the caller's remap directly and hands it back at the end
         if(clone_seri != nullptr)
-            seri.remap = *clone_seri;
+            seri.remap.swap(*clone_seri);
         bool temp_remap = seri.allow_remap;
         if(!deep_copy)
             seri.allow_remap = false;
         // seri.allow_remap = false;
 
-        wi::vector<std::string>* clone_filter_list = &shallow_clone_filter_list;
+        ComponentPlan* clone_plan = &shallow_clone_plan;
         if(deep_copy)
-            clone_filter_list = &full_clone_filter_list;
+            clone_plan = &full_clone_plan;
         
         ar_copy.SetReadModeAndResetPos(false);
-        for(auto& componentID : *clone_filter_list)
+        bool inactive_entity = inactives.Contains(entity);
+        wi::vector<std::pair<ComponentCopy::Handler*, wi::ecs::ComponentManager_Interface*>> copy_list;
+        for(auto& step : clone_plan->steps)
         {
-            auto compmgr = wiscene.componentLibrary.entries[componentID].component_manager.get();
-            auto& compver = wiscene.componentLibrary.entries[componentID].version;
-            seri.version = compver;
+            auto compmgr = step.component_manager;
+            // Disabled components are read from the cold store, the clone gets them as active
+            if(inactive_entity && step.cold != nullptr && step.cold->cold->Contains(entity))
+                compmgr = step.cold->cold;
+            if(step.copy != nullptr)
+            {
+                copy_list.push_back({step.copy, compmgr});
+                continue;
+            }
+            seri.version = step.version;
             compmgr->Component_Serialize(entity, ar_copy, seri);
         }
         wi::jobsystem::Wait(seri.ctx);
@@ -741,61 +2227,184 @@ namespace Game{
         wi::ecs::Entity clone_entity = wi::ecs::INVALID_ENTITY;
         if(clone_seri != nullptr)
         {
-            auto find_clone = clone_seri->find(entity);
-            if(find_clone != clone_seri->end())
+            auto find_clone = seri.remap.find(entity);
+            if(find_clone != seri.remap.end())
                 clone_entity = find_clone->second;
         }
         if(clone_entity == wi::ecs::INVALID_ENTITY)
             clone_entity = wi::ecs::CreateEntity();
         
 
+        for(auto& copy_pair : copy_list)
+        {
+            copy_pair.first->Copy(*copy_pair.second, entity, clone_entity, seri);
+        }
         ar_copy.SetReadModeAndResetPos(true);
-        for(auto& componentID : *clone_filter_list)
+        for(auto& step : clone_plan->steps)
         {
-            auto compmgr = wiscene.componentLibrary.entries[componentID].component_manager.get();
-            auto& compver = wiscene.componentLibrary.entries[componentID].version;
-            seri.version = compver;
-            compmgr->Component_Serialize(clone_entity, ar_copy, seri);
+            if(step.copy != nullptr)
+                continue;
+            seri.version = step.version;
+            step.component_manager->Component_Serialize(clone_entity, ar_copy, seri);
         }
         wi::jobsystem::Wait(seri.ctx);
 
+        auto inactive = inactives.GetComponent(entity);
+        if(inactive != nullptr)
+            _internal_Inactive_Prepare(*inactive);
+        const uint8_t* inactive_storage = (inactive != nullptr) ? _internal_Inactive_Storage(*inactive) : nullptr;
+        if(inactive_storage != nullptr)
+        {
+            wi::Archive ar_enable = wi::Archive(inactive_storage);
+            ar_enable.SetReadModeAndResetPos(true);
+            // Read jump headers
+            wi::vector<size_t> component_jump_list;
+            _internal_Read_Jumps(ar_enable, fallback_plan.steps.size(), component_jump_list);
+            for(auto& step : clone_plan->steps)
+            {
+                if(step.fallback_slot != ~0u)
+                {
+                    ar_enable.Jump(component_jump_list[step.fallback_slot]);
+                    seri.version = step.version;
+                    step.component_manager->Component_Serialize(clone_entity, ar_enable, seri);
+                }
+            }
+            wi::jobsystem::Wait(seri.ctx);
+        }
         if(clone_seri != nullptr)
         {
-            (*clone_seri)[entity] = clone_entity;
-            if(deep_copy)
+            seri.remap[entity] = clone_entity;
+            seri.remap.swap(*clone_seri);
+        }
+        presence.Set(clone_entity, PresenceIndex::State::ALIVE);
+        return clone_entity;
+    }
+
+    void Scene::Component_AttachBatch(const wi::vector<std::pair<wi::ecs::Entity, wi::ecs::Entity>>& attach_list)
+    {
+        if(attach_list.empty())
+            return;
+
+        // Order the pairs so that parents attached by this batch go before their children
+        wi::unordered_map<wi::ecs::Entity, size_t> child_index;
+        for(size_t i = 0; i < attach_list.size(); ++i)
+        {
+            child_index[attach_list[i].first] = i;
+        }
+        wi::vector<uint32_t> attach_depth(attach_list.size(), 0);
+        for(size_t i = 0; i < attach_list.size(); ++i)
+        {
+            wi::ecs::Entity parent = attach_list[i].second;
+            auto find_child = child_index.find(parent);
+            while((find_child != child_index.end()) && (attach_depth[i] < attach_list.size()))
             {
-                clone_seri->insert(seri.remap.begin(), seri.remap.end());
+                attach_depth[i]++;
+                find_child = child_index.find(attach_list[find_child->second].second);
             }
         }
+        wi::vector<size_t> attach_order(attach_list.size());
+        for(size_t i = 0; i < attach_order.size(); ++i)
+        {
+            attach_order[i] = i;
+        }
+        std::stable_sort(attach_order.begin(), attach_order.end(), [&attach_depth](size_t a, size_t b){
+            return attach_depth[a] < attach_depth[b];
+        });
 
-        auto inactive = inactives.GetComponent(entity);
-        if(inactive != nullptr)
+        // Set the parents, existing hierarchy components are detached in place instead of being removed and added again
+        for(auto& i : attach_order)
         {
-            wi::Archive ar_enable = wi::Archive(inactive->inactive_storage.data());
-            ar_enable.SetReadModeAndResetPos(true);
-            // Read jump headers
-            wi::unordered_map<std::string, size_t> component_jump_list;
-            for(auto& componentID : disable_filter_list)
+            auto& attach_pair = attach_list[i];
+            wi::scene::HierarchyComponent* hierarchy = wiscene.hierarchy.GetComponent(attach_pair.first);
+            if(hierarchy == nullptr)
+                hierarchy = &wiscene.hierarchy.Create(attach_pair.first);
+            else if(hierarchy->parentID != wi::ecs::INVALID_ENTITY)
             {
-                size_t jump;
-                ar_enable >> jump;
-                component_jump_list[componentID] = jump;
+                wi::scene::TransformComponent* transform = wiscene.transforms.GetComponent(attach_pair.first);
+                if(transform != nullptr)
+                    transform->ApplyTransform();
             }
-            for(auto& componentID : (*clone_filter_list))
+            hierarchy->parentID = attach_pair.second;
+        }
+
+        // Only the tail from the first attached child can be out of order, the entries before it kept their parents
+        size_t reorder_begin = wiscene.hierarchy.GetCount();
+        for(auto& attach_pair : attach_list)
+        {
+            reorder_begin = std::min(reorder_begin, wiscene.hierarchy.GetIndex(attach_pair.first));
+        }
+        bool reorder = false;
+        for(size_t i = reorder_begin; i < wiscene.hierarchy.GetCount() && !reorder; ++i)
+        {
+            wi::ecs::Entity parent = wiscene.hierarchy[i].parentID;
+            reorder = (parent != wi::ecs::INVALID_ENTITY) && wiscene.hierarchy.Contains(parent) && (wiscene.hierarchy.GetIndex(parent) > i);
+        }
+        if(reorder)
+        {
+            // Stable partition of the tail by depth, every parent ends up in front of its children
+            wi::vector<std::pair<wi::ecs::Entity, wi::scene::HierarchyComponent>> tail;
+            tail.reserve(wiscene.hierarchy.GetCount() - reorder_begin);
+            wi::unordered_set<wi::ecs::Entity> tail_set;
+            for(size_t i = reorder_begin; i < wiscene.hierarchy.GetCount(); ++i)
+            {
+                tail.push_back({wiscene.hierarchy.GetEntity(i), wiscene.hierarchy[i]});
+                tail_set.insert(tail.back().first);
+            }
+            wi::unordered_map<wi::ecs::Entity, uint32_t> tail_depth;
+            for(auto& tail_pair : tail)
             {
-                auto find_jump = component_jump_list.find(componentID);
-                if(find_jump != component_jump_list.end())
+                uint32_t depth = 0;
+                wi::ecs::Entity parent = tail_pair.second.parentID;
+                while((tail_set.find(parent) != tail_set.end()) && (depth < tail.size()))
                 {
-                    ar_enable.Jump(find_jump->second);
-                    auto compmgr = wiscene.componentLibrary.entries[componentID].component_manager.get();
-                    auto& compver = wiscene.componentLibrary.entries[componentID].version;
-                    seri.version = compver;
-                    compmgr->Component_Serialize(clone_entity, ar_enable, seri);
+                    depth++;
+                    parent = wiscene.hierarchy.GetComponent(parent)->parentID;
                 }
+                tail_depth[tail_pair.first] = depth;
+            }
+            std::stable_sort(tail.begin(), tail.end(), [&tail_depth](const auto& a, const auto& b){
+                return tail_depth[a.first] < tail_depth[b.first];
+            });
+
+            // Removing from the back is a pop, the tail is appended again in the new order
+            while(wiscene.hierarchy.GetCount() > reorder_begin)
+            {
+                wiscene.hierarchy.Remove(wiscene.hierarchy.GetEntity(wiscene.hierarchy.GetCount() - 1));
+            }
+            for(auto& tail_pair : tail)
+            {
+                wiscene.hierarchy.Create(tail_pair.first) = tail_pair.second;
             }
-            wi::jobsystem::Wait(seri.ctx);
         }
-        return clone_entity;
+
+        // Children need a transform to follow a parent that has one, created before the pointers are taken
+        for(auto& attach_pair : attach_list)
+        {
+            if(wiscene.transforms.Contains(attach_pair.second) && !wiscene.transforms.Contains(attach_pair.first))
+                wiscene.transforms.Create(attach_pair.first);
+        }
+
+        // Update the world transforms a depth level at a time, the children of a level are independent of each other
+        wi::jobsystem::context ctx;
+        size_t level_begin = 0;
+        while(level_begin < attach_order.size())
+        {
+            size_t level_end = level_begin;
+            while((level_end < attach_order.size()) && (attach_depth[attach_order[level_end]] == attach_depth[attach_order[level_begin]]))
+                level_end++;
+            wi::jobsystem::Dispatch(ctx, uint32_t(level_end - level_begin), 64, [this, level_begin, &attach_list, &attach_order](wi::jobsystem::JobArgs args){
+                auto& attach_pair = attach_list[attach_order[level_begin + args.jobIndex]];
+                wi::scene::TransformComponent* transform_parent = wiscene.transforms.GetComponent(attach_pair.second);
+                wi::scene::TransformComponent* transform_child = wiscene.transforms.GetComponent(attach_pair.first);
+                if((transform_parent != nullptr) && (transform_child != nullptr))
+                    transform_child->UpdateTransform_Parented(*transform_parent);
+                wi::scene::LayerComponent* layer_child = wiscene.layers.GetComponent(attach_pair.first);
+                if(layer_child != nullptr)
+                    wiscene.hierarchy.GetComponent(attach_pair.first)->layerMask_bind = layer_child->layerMask;
+            });
+            wi::jobsystem::Wait(ctx);
+            level_begin = level_end;
+        }
     }
 
     void Scene::Load(std::string file)
@@ -834,17 +2443,48 @@ namespace Game{
         for(auto& scriptID : script_enlist_job.script_load_list)
         {
             Scripting::Script* script = scripts.GetComponent(scriptID);
+
+            // A script that is already in memory runs right away, any other is read on the I/O threads first and runs on a later frame
+            Filesystem::ReadResult script_result;
+            auto script_read = script_reads.find(scriptID);
+            if(script_read == script_reads.end())
+            {
+                if(!Filesystem::MapFile(script->file, script_result.view) || !Filesystem::IsResident(script_result.view))
+                {
+                    std::future<Filesystem::ReadResult> script_future = Filesystem::ReadAsync(script->file);
+                    if(script_future.valid()) // I/O queue is full otherwise, try again next frame
+                        script_reads[scriptID] = std::move(script_future);
+                    continue;
+                }
+                script_result.success = true;
+            }
+            else
+            {
+                if(script_read->second.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+                    continue;
+                script_result = script_read->second.get();
+                script_reads.erase(script_read);
+            }
+
             // wi::lua::RunText("dofile(\""+Filesystem::GetActualPath(script->file)+"\","+std::to_string(scriptID)+")");
-            lua_State* L = wi::lua::GetLuaState();
-            lua_getglobal(L, "dofile");
-            lua_pushstring(L, Filesystem::GetActualPath(script->file).c_str());
-            lua_pushinteger(L, scriptID);
-            lua_pushstring(L, script->params.c_str());
-            lua_call(L, 3, 1);
-            wi::ecs::Entity stub_PID = (wi::ecs::Entity)wi::lua::SGetLongLong(L, -1);
-            lua_pop(L, 1);
+            // Runs straight from the mapped file, nested dofile calls resolve through the mounts
+            if(script_result.success)
+                script->failed = !Scripting::DoBuffer(script->file, script_result.view.data, script_result.view.size, scriptID, script->params);
+            else
+            {
+                wi::backlog::post("Failed to read script " + script->file, wi::backlog::LogLevel::Error);
+                script->failed = true;
+            }
             script->done_init = true;
         }
+        // Scripts removed while their file was still being read
+        for(auto it = script_reads.begin(); it != script_reads.end();)
+        {
+            if(scripts.Contains(it->first))
+                ++it;
+            else
+                it = script_reads.erase(it);
+        }
     }
     struct _internal_PrefabUpdateSystem_stream_enlist_job
     {
@@ -852,39 +2492,226 @@ namespace Game{
         wi::unordered_map<wi::ecs::Entity,std::string> deferred_lib_stream;
         wi::vector<std::pair<wi::ecs::Entity,float>> fade_update_list;
         wi::vector<std::pair<wi::ecs::Entity,std::pair<wi::ecs::Entity, wi::scene::TransformComponent*>>> preview_create_list;
-        wi::unordered_map<wi::ecs::Entity, std::string> load_list;
-        wi::unordered_map<wi::ecs::Entity, std::string> unload_list;
+        wi::vector<std::pair<wi::ecs::Entity, std::string>> load_list;
+        wi::vector<std::pair<wi::ecs::Entity, std::string>> unload_list;
+        wi::unordered_map<std::string, float> stream_demand; // Files that prefabs want loaded this frame, with the priority of the closest one
+        wi::unordered_set<std::string> visible_list; // Files that have a prefab in range this frame
+        wi::unordered_map<std::string, float> prefetch_demand; // Files on the predicted path of the loader, with the distance along the path
         wi::unordered_map<std::string, wi::ecs::Entity> library_create_list;
+        wi::unordered_set<std::string> archive_create_list;
+        wi::vector<std::pair<wi::ecs::Entity, std::pair<Scene::StreamIndex::Entry, wi::primitive::AABB>>> index_update_list;
+        wi::vector<wi::ecs::Entity> sync_list; // Prefabs checked for reindexing this frame
+        wi::vector<uint8_t> sync_state; // Per prefab index: 0 - indexed and unchanged, 1 - indexed and changed, 2 - not indexed
+        wi::vector<wi::ecs::Entity> candidates; // Prefabs that need to be visited this frame
+        wi::vector<uint8_t> candidates_state; // 0 - settled, 1 - active, 2 - prefab no longer exists
+        wi::vector<uint32_t> candidates_slot; // Cached bounds slot of each candidate
+        wi::vector<float> candidates_distance_sq; // Squared distance from the loader to the bounds
+        wi::vector<float> candidates_distance_scratch;
+        wi::vector<float> candidates_eye_distance_sq; // Squared distance from the camera to the bounds center
         std::mutex stream_list_mutex;
     };
     void Scene::RunPrefabUpdateSystem(float dt, wi::jobsystem::context& ctx)
     {
-        // Finish load callback
-        for(auto stream_callback : stream_callbacks)
+        // Finish load callback, in the order the requests were submitted so the result does not depend on which worker was faster
+        auto stream_job_data = GetStreamJobData();
+        auto& stream_reorder = stream_job_data->stream_reorder;
+        std::shared_ptr<StreamData> stream_callback;
+        while(stream_job_data->stream_callbacks.TryPop(stream_callback))
+        {
+            stream_reorder.push_back(stream_callback);
+        }
         {
-            _internal_Finish_Stream(stream_callback);
+            std::scoped_lock overflow_lock(stream_job_data->overflow_mutex);
+            stream_reorder.insert(stream_reorder.end(), stream_job_data->stream_callbacks_overflow.begin(), stream_job_data->stream_callbacks_overflow.end());
+            stream_job_data->stream_callbacks_overflow.clear();
         }
-        stream_callbacks.clear();
+        std::sort(stream_reorder.begin(), stream_reorder.end(), [](const std::shared_ptr<StreamData>& a, const std::shared_ptr<StreamData>& b){
+            return a->sequence < b->sequence;
+        });
+        wi::Timer stream_finish_timer;
+        size_t stream_finish_count = 0;
+        while((stream_finish_count < stream_reorder.size()) && (stream_reorder[stream_finish_count]->sequence == stream_job_data->finish_sequence))
+        {
+            if(!_internal_Finish_Stream(stream_reorder[stream_finish_count], stream_finish_timer, stream_finish_budget_ms))
+                break; // Out of budget, resume next frame
+            stream_job_data->finish_sequence++;
+            stream_finish_count++;
+            if(stream_finish_timer.elapsed_milliseconds() >= stream_finish_budget_ms)
+                break;
+        }
+        stream_reorder.erase(stream_reorder.begin(), stream_reorder.begin() + stream_finish_count);
+        stream_stats.finish_time = float(stream_finish_timer.elapsed_milliseconds());
+        stream_stats.finish_time_max = std::max(stream_stats.finish_time_max, stream_stats.finish_time);
+        stream_stats.finish_backlog = uint32_t(stream_reorder.size());
 
-        // Stream prefabs
         _internal_PrefabUpdateSystem_stream_enlist_job stream_enlist_job;
         stream_enlist_job.dt = dt;
-        wi::jobsystem::Dispatch(ctx, prefabs.GetCount(), 255, [this, &stream_enlist_job](wi::jobsystem::JobArgs jobArgs){
-            bool do_init = false;
-            bool do_stream = false;
-            
+        stream_frame++;
+
+        // Sync stream index, every prefab is compared against its entry so a new, moved or changed prefab is never missed
+        // The compare is a lookup and a few fields per prefab, only the prefabs that differ get reindexed
+        // Prefab_MarkDirty and archive changes reindex through the dirty set
+        static const XMFLOAT4X4 identity_world = wi::scene::TransformComponent().world;
+        auto& sync_list = stream_enlist_job.sync_list;
+        auto& sync_state = stream_enlist_job.sync_state;
+        size_t prefab_count = prefabs.GetCount();
+        sync_state.resize(prefab_count);
+        wi::jobsystem::Dispatch(ctx, (uint32_t)prefab_count, 255, [this, &sync_state](wi::jobsystem::JobArgs jobArgs){
             auto prefabID = prefabs.GetEntity(jobArgs.jobIndex);
-            Prefab& prefab = prefabs[jobArgs.jobIndex];
+            auto find_entry = stream_index.entries.find(prefabID);
+            if(find_entry == stream_index.entries.end())
+            {
+                sync_state[jobArgs.jobIndex] = 2;
+                return;
+            }
+            const StreamIndex::Entry& entry = find_entry->second;
+            const Prefab& prefab = prefabs[jobArgs.jobIndex];
+            wi::scene::TransformComponent* prefab_transform = wiscene.transforms.GetComponent(prefabID);
+            const XMFLOAT4X4& world = (prefab_transform != nullptr) ? prefab_transform->world : identity_world;
+            bool unchanged = (entry.stream_mode == prefab.stream_mode) &&
+                (entry.stream_distance_multiplier == prefab.stream_distance_multiplier) &&
+                (entry.file == prefab.file) &&
+                (std::memcmp(&entry.world, &world, sizeof(XMFLOAT4X4)) == 0);
+            sync_state[jobArgs.jobIndex] = unchanged ? 0 : 1;
+        });
+        wi::jobsystem::Wait(ctx);
+
+        sync_list.assign(stream_index.dirty.begin(), stream_index.dirty.end());
+        stream_index.dirty.clear();
+        size_t indexed_count = 0;
+        for(size_t i = 0; i < prefab_count; ++i)
+        {
+            if(sync_state[i] != 2)
+                indexed_count++;
+            if(sync_state[i] != 0)
+                sync_list.push_back(prefabs.GetEntity(i));
+        }
+        std::sort(sync_list.begin(), sync_list.end());
+        sync_list.erase(std::unique(sync_list.begin(), sync_list.end()), sync_list.end());
+        bool prefabs_removed = (indexed_count < stream_index.entries.size()); // Some entries belong to prefabs that no longer exist
+
+        wi::jobsystem::Dispatch(ctx, (uint32_t)sync_list.size(), 255, [this, &stream_enlist_job](wi::jobsystem::JobArgs jobArgs){
+            auto prefabID = stream_enlist_job.sync_list[jobArgs.jobIndex];
+            Prefab* prefab_get = prefabs.GetComponent(prefabID);
+            if(prefab_get == nullptr)
+                return;
+            Prefab& prefab = *prefab_get;
 
             auto find_archive = scene_db.find(prefab.file);
+            if(find_archive == scene_db.end()) // Create archive first, the prefab is still unindexed on the next update and gets picked up then
+            {
+                std::scoped_lock stream_list_sync(stream_enlist_job.stream_list_mutex);
+                stream_enlist_job.archive_create_list.insert(prefab.file);
+                return;
+            }
+
+            Archive& archive = find_archive->second;
+            if((prefab.preview_object == wi::ecs::INVALID_ENTITY) && (wiscene.meshes.Contains(archive.previewID))) // Create preview object, previews are shown regardless of distance
+            {
+                std::scoped_lock stream_list_sync(stream_enlist_job.stream_list_mutex);
+                stream_enlist_job.preview_create_list.push_back({prefabID,{archive.previewID, &archive.preview_transform}});
+            }
+
+            wi::scene::TransformComponent* prefab_transform = wiscene.transforms.GetComponent(prefabID);
+            const XMFLOAT4X4& world = (prefab_transform != nullptr) ? prefab_transform->world : identity_world;
+
+            auto find_entry = stream_index.entries.find(prefabID);
+            if(find_entry != stream_index.entries.end())
+            {
+                const StreamIndex::Entry& entry = find_entry->second;
+                if((entry.stream_mode == prefab.stream_mode) &&
+                    (entry.stream_distance_multiplier == prefab.stream_distance_multiplier) &&
+                    (entry.bounds_version == archive.bounds_version) &&
+                    (entry.file == prefab.file) &&
+                    (std::memcmp(&entry.world, &world, sizeof(XMFLOAT4X4)) == 0))
+                    return;
+            }
+
+            StreamIndex::Entry entry;
+            entry.world = world;
+            entry.stream_mode = prefab.stream_mode;
+            entry.stream_distance_multiplier = prefab.stream_distance_multiplier;
+            entry.bounds_version = archive.bounds_version;
+            entry.file = prefab.file;
+            wi::primitive::AABB bounds = _internal_Prefab_StreamBounds(archive.bounds, prefab.stream_distance_multiplier, world);
+
+            std::scoped_lock stream_list_sync(stream_enlist_job.stream_list_mutex);
+            stream_enlist_job.index_update_list.push_back({prefabID, {entry, bounds}});
+        });
+        wi::jobsystem::Wait(ctx);
+
+        for(auto& file : stream_enlist_job.archive_create_list)
+        {
+            Archive& archive = scene_db[file];
+            archive.file = file;
+            archive.Init();
+        }
+        for(auto& index_update : stream_enlist_job.index_update_list)
+        {
+            stream_index.Insert(index_update.first, index_update.second.first, index_update.second.second);
+            stream_index.active.insert(index_update.first); // Visit at least once after a change
+        }
+        if(prefabs_removed) // Drop the removed prefabs from the index
+        {
+            wi::vector<wi::ecs::Entity> remove_list;
+            for(auto& entry_pair : stream_index.entries)
+            {
+                if(!prefabs.Contains(entry_pair.first))
+                    remove_list.push_back(entry_pair.first);
+            }
+            for(auto& prefabID : remove_list)
+                stream_index.Remove(prefabID);
+        }
+
+        // Gather the prefabs that cross the loader, plus the ones that still have work to do
+        if(stream_index.brute_force)
+            stream_enlist_job.candidates = stream_index.bounds.entity;
+        else
+            stream_index.Query(stream_loader_bounds, stream_enlist_job.candidates);
+        stream_enlist_job.candidates.insert(stream_enlist_job.candidates.end(), stream_index.nonspatial.begin(), stream_index.nonspatial.end());
+        stream_enlist_job.candidates.insert(stream_enlist_job.candidates.end(), stream_index.active.begin(), stream_index.active.end());
+        std::sort(stream_enlist_job.candidates.begin(), stream_enlist_job.candidates.end());
+        stream_enlist_job.candidates.erase(std::unique(stream_enlist_job.candidates.begin(), stream_enlist_job.candidates.end()), stream_enlist_job.candidates.end());
+        stream_enlist_job.candidates_state.resize(stream_enlist_job.candidates.size());
+
+        // Batch distance test on the cached bounds
+        size_t candidate_count = stream_enlist_job.candidates.size();
+        stream_enlist_job.candidates_slot.resize(candidate_count);
+        stream_enlist_job.candidates_distance_sq.resize(candidate_count);
+        stream_enlist_job.candidates_distance_scratch.resize(candidate_count);
+        stream_enlist_job.candidates_eye_distance_sq.resize(candidate_count);
+        for(size_t i = 0; i < candidate_count; ++i)
+        {
+            stream_enlist_job.candidates_slot[i] = stream_index.entries[stream_enlist_job.candidates[i]].slot;
+        }
+        stream_index.DistanceBatch(
+            stream_enlist_job.candidates_slot,
+            XMFLOAT3(stream_loader_bounds.x, stream_loader_bounds.y, stream_loader_bounds.z),
+            stream_enlist_job.candidates_distance_sq.data(),
+            stream_enlist_job.candidates_distance_scratch.data());
+        stream_index.DistanceBatch(
+            stream_enlist_job.candidates_slot,
+            wi::scene::GetCamera().Eye,
+            stream_enlist_job.candidates_distance_scratch.data(),
+            stream_enlist_job.candidates_eye_distance_sq.data());
 
-            if(find_archive == scene_db.end()) // Create archive first
+        // Stream prefabs
+        wi::jobsystem::Dispatch(ctx, (uint32_t)stream_enlist_job.candidates.size(), 255, [this, &stream_enlist_job](wi::jobsystem::JobArgs jobArgs){
+            bool do_init = false;
+            bool do_stream = false;
+            
+            auto prefabID = stream_enlist_job.candidates[jobArgs.jobIndex];
+            stream_enlist_job.candidates_state[jobArgs.jobIndex] = 0;
+
+            Prefab* prefab_get = prefabs.GetComponent(prefabID);
+            if(prefab_get == nullptr)
             {
-                scene_db[prefab.file] = {};
-                Archive& archive = scene_db[prefab.file];
-                archive.file = prefab.file;
-                archive.Init();
+                stream_enlist_job.candidates_state[jobArgs.jobIndex] = 2;
+                return;
             }
+            Prefab& prefab = *prefab_get;
+
+            auto find_archive = scene_db.find(prefab.file);
 
             // Determine whether to load or not
             if(find_archive != (scene_db.end()))
@@ -892,7 +2719,10 @@ namespace Game{
                 Archive& archive = find_archive->second;
 
                 // Is loadable check START
+                // Loaded prefabs are tested against the wider unload thresholds, so they don't flicker at the edge
+                bool is_resident = prefab.loaded || (prefab.fade_factor > 0.f);
                 bool is_loadable = false;
+                float stream_priority = 0.f; // DIRECT prefabs stream before anything else
                 switch(prefab.stream_mode)
                 {
                     case Prefab::StreamMode::DIRECT:
@@ -903,66 +2733,46 @@ namespace Game{
                     case Prefab::StreamMode::DISTANCE:
                     {
                         // Calculate by zone distance
-                        wi::primitive::AABB zone_check = archive.bounds;
-                        wi::scene::TransformComponent transformator;
-                        
-                        XMFLOAT3 zone_center = XMFLOAT3(((zone_check._max.x-zone_check._min.x)*0.5f)+zone_check._min.x,((zone_check._max.y-zone_check._min.y)*0.5f)+zone_check._min.y,((zone_check._max.z-zone_check._min.z)*0.5f)+zone_check._min.z);
-                        transformator.Translate(XMFLOAT3(-zone_center.x, -zone_center.y, -zone_center.z));
-                        transformator.UpdateTransform();
-                        zone_check = zone_check.transform(transformator.world);
-                        
-                        transformator = wi::scene::TransformComponent();
-                        transformator.Scale(XMFLOAT3(prefab.stream_distance_multiplier, prefab.stream_distance_multiplier, prefab.stream_distance_multiplier));
-                        transformator.UpdateTransform();
-                        zone_check = zone_check.transform(transformator.world);
-                        
-                        wi::scene::TransformComponent* prefab_transform = wiscene.transforms.GetComponent(prefabID);
-                        if(prefab_transform != nullptr)
-                            transformator = *prefab_transform;
-                        zone_check = zone_check.transform(transformator.world);
-
-                        is_loadable = zone_check.intersects(
-                            wi::primitive::Sphere(
-                                XMFLOAT3(stream_loader_bounds.x, stream_loader_bounds.y, stream_loader_bounds.z),
-                                stream_loader_bounds.w)
-                        );
+                        float zone_distance = stream_loader_bounds.w * (is_resident ? std::max(stream_unload_distance_multiplier, 1.f) : 1.f);
+                        is_loadable = stream_enlist_job.candidates_distance_sq[jobArgs.jobIndex] < (zone_distance * zone_distance);
+                        stream_priority = std::sqrt(stream_enlist_job.candidates_distance_sq[jobArgs.jobIndex]);
                         break;
                     }
                     case Prefab::StreamMode::SCREEN_ESTATE:
                     {
                         // Calculate by zone estate
-                        wi::primitive::AABB zone_check = archive.bounds;
-                        wi::scene::TransformComponent transformator;
-                        
-                        XMFLOAT3 zone_center = XMFLOAT3(((zone_check._max.x-zone_check._min.x)*0.5f)+zone_check._min.x,((zone_check._max.y-zone_check._min.y)*0.5f)+zone_check._min.y,((zone_check._max.z-zone_check._min.z)*0.5f)+zone_check._min.z);
-                        transformator.Translate(XMFLOAT3(-zone_center.x, -zone_center.y, -zone_center.z));
-                        transformator.UpdateTransform();
-                        zone_check = zone_check.transform(transformator.world);
-                        
-                        transformator = wi::scene::TransformComponent();
-                        transformator.Scale(XMFLOAT3(prefab.stream_distance_multiplier, prefab.stream_distance_multiplier, prefab.stream_distance_multiplier));
-                        transformator.UpdateTransform();
-                        zone_check = zone_check.transform(transformator.world);
-                        
-                        wi::scene::TransformComponent* prefab_transform = wiscene.transforms.GetComponent(prefabID);
-                        if(prefab_transform != nullptr)
-                            transformator = *prefab_transform;
-                        zone_check = zone_check.transform(transformator.world);
-
-                        is_loadable = ((zone_check.getRadius()/wi::math::Distance(zone_center,wi::scene::GetCamera().Eye)) > (stream_loader_screen_estate));
+                        float zone_radius = stream_index.bounds.radius[stream_enlist_job.candidates_slot[jobArgs.jobIndex]];
+                        float zone_estate = stream_loader_screen_estate * (is_resident ? std::min(stream_unload_screen_estate_multiplier, 1.f) : 1.f);
+                        is_loadable = ((zone_radius/std::sqrt(stream_enlist_job.candidates_eye_distance_sq[jobArgs.jobIndex])) > zone_estate);
+                        stream_priority = std::sqrt(stream_enlist_job.candidates_eye_distance_sq[jobArgs.jobIndex]);
                         break;
                     }
                     default:
                         break;
                 }
+                // An evicted library would stream straight back in, it waits until a deep copy needs it again
+                if((prefab.copy_mode == Prefab::CopyMode::LIBRARY) && archive.evicted)
+                    is_loadable = false;
+                if(prefab.loaded)
+                {
+                    prefab.residency_time += stream_enlist_job.dt;
+                    if(prefab.residency_time < stream_min_residency_time) // Freshly loaded prefabs stay for a while
+                        is_loadable = true;
+                }
+                else
+                    prefab.residency_time = 0.f;
                 // Is loadable check END
 
-                if((wiscene.meshes.Contains(archive.previewID)) && (prefab.preview_object == wi::ecs::INVALID_ENTITY)) // Create preview object
-                    stream_enlist_job.preview_create_list.push_back({prefabID,{archive.previewID, &archive.preview_transform}});
-
                 if(is_loadable && (!prefab.loaded) && (prefab.fade_factor <= 0.f)) // Load
                 {
                     prefab.tostash_prefabID = prefabID;
+                    {
+                        // Keeps a pending request for this file alive, the closest prefab sets its priority
+                        std::scoped_lock stream_list_sync(stream_enlist_job.stream_list_mutex);
+                        auto find_demand = stream_enlist_job.stream_demand.find(archive.file);
+                        if((find_demand == stream_enlist_job.stream_demand.end()) || (stream_priority < find_demand->second))
+                            stream_enlist_job.stream_demand[archive.file] = stream_priority;
+                    }
                     if(archive.load_state == Archive::LoadState::UNLOADED)
                     {
                         std::scoped_lock stream_list_sync(stream_enlist_job.stream_list_mutex);
@@ -974,20 +2784,20 @@ namespace Game{
                                 stream_enlist_job.library_create_list[archive.file] = prefabID;
                             }
                             else
-                                stream_enlist_job.load_list[wi::ecs::INVALID_ENTITY] = archive.file; // Reload
+                                stream_enlist_job.load_list.push_back({wi::ecs::INVALID_ENTITY, archive.file}); // Reload
                         }
                         else
                         {
                             archive.prefabID = prefabID;
                             archive.remap = prefab.remap;
-                            stream_enlist_job.load_list[wi::ecs::INVALID_ENTITY] = archive.file;
+                            stream_enlist_job.load_list.push_back({wi::ecs::INVALID_ENTITY, archive.file});
                         }
                     }
 
                     if(archive.load_state == Archive::LoadState::LOADED) // Clone, but only after streaming
                     {
                         std::scoped_lock stream_list_sync(stream_enlist_job.stream_list_mutex);
-                        stream_enlist_job.load_list[((archive.prefabID == prefabID) ? wi::ecs::INVALID_ENTITY : prefabID)] = archive.file;
+                        stream_enlist_job.load_list.push_back({((archive.prefabID == prefabID) ? wi::ecs::INVALID_ENTITY : prefabID), archive.file});
                     }    
                 }
 
@@ -1025,12 +2835,117 @@ namespace Game{
                 if(!is_loadable && prefab.loaded && (prefab.fade_factor == 0.f)) // Unload
                 {
                     std::scoped_lock stream_list_sync(stream_enlist_job.stream_list_mutex);
-                    stream_enlist_job.unload_list[((archive.prefabID == prefabID) ? wi::ecs::INVALID_ENTITY : prefabID)] = archive.file;
+                    stream_enlist_job.unload_list.push_back({((archive.prefabID == prefabID) ? wi::ecs::INVALID_ENTITY : prefabID), archive.file});
+                }
+
+                if(is_loadable || prefab.loaded || (prefab.fade_factor > 0.f))
+                    stream_enlist_job.candidates_state[jobArgs.jobIndex] = 1;
+
+                if(is_loadable)
+                {
+                    std::scoped_lock stream_list_sync(stream_enlist_job.stream_list_mutex);
+                    stream_enlist_job.visible_list.insert(archive.file);
                 }
             }
         });
         wi::jobsystem::Wait(ctx);
 
+        for(auto& file : stream_enlist_job.visible_list)
+        {
+            scene_db[file].last_visible_frame = stream_frame;
+        }
+
+        // Track the loader's velocity for prefetching
+        XMFLOAT3 stream_loader_position = XMFLOAT3(stream_loader_bounds.x, stream_loader_bounds.y, stream_loader_bounds.z);
+        if(stream_loader_tracked && (dt > 0.f))
+        {
+            XMFLOAT3 displacement = XMFLOAT3(
+                stream_loader_position.x - stream_loader_previous.x,
+                stream_loader_position.y - stream_loader_previous.y,
+                stream_loader_position.z - stream_loader_previous.z);
+            float displacement_length = std::sqrt(displacement.x * displacement.x + displacement.y * displacement.y + displacement.z * displacement.z);
+            if(displacement_length > (stream_loader_bounds.w * 4.f)) // Teleported, the old velocity means nothing
+                stream_loader_velocity = XMFLOAT3(0,0,0);
+            else
+            {
+                stream_loader_velocity.x += (displacement.x / dt - stream_loader_velocity.x) * 0.25f;
+                stream_loader_velocity.y += (displacement.y / dt - stream_loader_velocity.y) * 0.25f;
+                stream_loader_velocity.z += (displacement.z / dt - stream_loader_velocity.z) * 0.25f;
+            }
+        }
+        stream_loader_previous = stream_loader_position;
+        stream_loader_tracked = true;
+
+        // Predictive prefetch, sweep loader sized spheres along the predicted path
+        // Only DISTANCE prefabs that own their archive are prefetched, the rest depend on other prefabs to load
+        float stream_loader_speed = std::sqrt(
+            stream_loader_velocity.x * stream_loader_velocity.x +
+            stream_loader_velocity.y * stream_loader_velocity.y +
+            stream_loader_velocity.z * stream_loader_velocity.z);
+        float prefetch_distance = stream_loader_speed * stream_prefetch_time;
+        if((prefetch_distance > 0.f) && (stream_loader_bounds.w > 0.f))
+        {
+            uint32_t prefetch_steps = std::min(uint32_t(std::ceil(prefetch_distance / stream_loader_bounds.w)), std::max(stream_prefetch_step_limit, 1u));
+            wi::unordered_map<wi::ecs::Entity, float> prefetch_candidates;
+            wi::vector<wi::ecs::Entity> prefetch_query;
+            for(uint32_t step = 1; step <= prefetch_steps; ++step)
+            {
+                float step_time = stream_prefetch_time * float(step) / float(prefetch_steps);
+                XMFLOAT4 step_sphere = XMFLOAT4(
+                    stream_loader_position.x + stream_loader_velocity.x * step_time,
+                    stream_loader_position.y + stream_loader_velocity.y * step_time,
+                    stream_loader_position.z + stream_loader_velocity.z * step_time,
+                    stream_loader_bounds.w);
+                prefetch_query.clear();
+                stream_index.Query(step_sphere, prefetch_query);
+                for(auto& prefabID : prefetch_query)
+                {
+                    if(prefetch_candidates.find(prefabID) == prefetch_candidates.end())
+                        prefetch_candidates[prefabID] = stream_loader_speed * step_time;
+                }
+            }
+
+            for(auto& prefetch_pair : prefetch_candidates)
+            {
+                auto prefabID = prefetch_pair.first;
+                Prefab* prefab = prefabs.GetComponent(prefabID);
+                if((prefab == nullptr) ||
+                    (prefab->stream_mode != Prefab::StreamMode::DISTANCE) ||
+                    (prefab->copy_mode != Prefab::CopyMode::SHALLOW_COPY) ||
+                    prefab->loaded || (prefab->fade_factor > 0.f))
+                    continue;
+                if(stream_enlist_job.stream_demand.find(prefab->file) != stream_enlist_job.stream_demand.end()) // Already loading for real
+                    continue;
+                auto find_archive = scene_db.find(prefab->file);
+                if((find_archive == scene_db.end()) || (find_archive->second.load_state != Archive::LoadState::UNLOADED))
+                    continue;
+
+                auto find_prefetch_demand = stream_enlist_job.prefetch_demand.find(prefab->file);
+                if((find_prefetch_demand != stream_enlist_job.prefetch_demand.end()) && (find_prefetch_demand->second <= prefetch_pair.second))
+                    continue;
+                stream_enlist_job.prefetch_demand[prefab->file] = prefetch_pair.second;
+
+                Archive& archive = find_archive->second;
+                if(archive.prefetch_data == nullptr)
+                {
+                    archive.prefabID = prefabID;
+                    archive.remap = prefab->remap;
+                    archive.Prefetch(prefetch_pair.second);
+                }
+            }
+        }
+
+        // Keep track of prefabs that still need to be visited next frame
+        stream_index.active.clear();
+        for(size_t i = 0; i < stream_enlist_job.candidates.size(); ++i)
+        {
+            auto prefabID = stream_enlist_job.candidates[i];
+            if(stream_enlist_job.candidates_state[i] == 1)
+                stream_index.active.insert(prefabID);
+            if(stream_enlist_job.candidates_state[i] == 2)
+                stream_index.Remove(prefabID);
+        }
+
         // Library creation
         for(auto& library_create_pair : stream_enlist_job.library_create_list)
         {
@@ -1073,11 +2988,20 @@ namespace Game{
         });
         wi::jobsystem::Wait(ctx);
 
-        // Process loads
+        // Process loads, prefabs of an already loaded archive are instanced together
+        wi::unordered_map<std::string, wi::vector<wi::ecs::Entity>> instance_list;
         for(auto& load_pair : stream_enlist_job.load_list)
         {
             Archive& archive = scene_db[load_pair.second];
-            archive.Load(load_pair.first);
+            archive.evicted = false; // Wanted again, a library may come back
+            if((load_pair.first != wi::ecs::INVALID_ENTITY) && (archive.load_state == Archive::LoadState::LOADED))
+                instance_list[load_pair.second].push_back(load_pair.first);
+            else
+                archive.Load(load_pair.first);
+        }
+        for(auto& instance_pair : instance_list)
+        {
+            scene_db[instance_pair.first].Instance(instance_pair.second);
         }
 
         // Process unloads
@@ -1086,12 +3010,22 @@ namespace Game{
             Archive& archive = scene_db[unload_pair.second];
             archive.Unload(unload_pair.first);
         }
+
+        // Keep loaded archives within the memory budget
+        _internal_Run_Residency();
+
+        // Hand the most urgent requests to the stream worker
+        _internal_Schedule_Stream(stream_enlist_job.stream_demand, stream_enlist_job.prefetch_demand);
     }
 
     void Scene::PreUpdate(float dt)
     {
         wi::jobsystem::context update_ctx;
-        std::scoped_lock stream_lock(stream_mutex);
+
+        // Free the cold components of entities that were removed without Entity_Remove
+        cold_store.Sweep(inactives, cold_sweep_limit);
+        // Pack inactive slabs that have been sitting around
+        _internal_Run_Inactive_Compression(*this, dt);
 
         // Run scripting update
         RunScriptUpdateSystem(update_ctx);
@@ -1102,6 +3036,5 @@ namespace Game{
     void Scene::Update(float dt)
     {
         wi::jobsystem::context update_ctx;
-        std::scoped_lock stream_lock(stream_mutex);
     }
 }
\ No newline at end of file
@@ -2,26 +2,70 @@
 #include "stdafx.h"
 
 #include "Scripting.h"
+#include "Filesystem.h"
+#include "Queue.h"
+#include "Remap.h"
 
 namespace Game{
     struct Scene
     {
         // Scene streaming structures
+        struct StreamData;
+        // Single file that packs the loose scene files, each section holds the same bytes as the loose file
+        // |- header -> magic, version, section count
+        // |- section table -> byte offset and size of each section
+        // |- sections -> bounds, preview, scene
+        // Texture names in the sections are relative to the working directory, since a memory archive has no source directory
+        struct Bundle
+        {
+            static constexpr uint32_t MAGIC = 0x4c444e42; // BNDL
+            static constexpr uint32_t VERSION = 1;
+            enum class Section : uint32_t
+            {
+                BOUNDS,
+                PREVIEW,
+                SCENE,
+                COUNT
+            };
+            struct Range
+            {
+                uint64_t offset = 0;
+                uint64_t size = 0;
+            };
+            Range sections[size_t(Section::COUNT)];
+            bool valid = false;
+
+            bool ReadHeader(const std::string& file);
+            bool MapSection(const std::string& file, Section section, Filesystem::FileView& view) const; // Maps the bundle and hands out only the section
+            static bool Write(const std::string& file, const wi::vector<uint8_t> (&section_data)[size_t(Section::COUNT)]);
+        };
         struct Archive
         {
             // Scene file structure
+            // |- scene.bundle  -> all of the below in one file, used when it exists
             // |- scene.wiscene  -> main scene file
             // |- scene.preview  -> a single entity that stores the preview data
-            // |- scene.area  -> a file that stores a float, about a scene boundary
+            // |- scene.bounds  -> a file that stores the scene boundary
 
             std::string file; // File name of the wiscene file
             wi::ecs::Entity prefabID = wi::ecs::INVALID_ENTITY; // Target prefab if exists
-            wi::unordered_map<uint64_t, wi::ecs::Entity> remap; // Remap data for the serialized file
+            RemapTable remap; // Remap data for the serialized file
             uint32_t dependency_count = 0; // Prefab dependency counter, useful for determining wheter to load or unload from disk
 
+            // Residency data
+            uint64_t resident_bytes = 0; // Estimated memory of the loaded archive, measured from the merged components
+            uint64_t last_visible_frame = 0; // Last prefab update where a prefab of this archive was in range
+            bool cached = false; // Out of range and disabled, but kept in memory until the residency manager evicts it
+            bool evicted = false; // Dropped by the residency manager, its library prefab waits for a clone to ask for it again
+            std::shared_ptr<StreamData> prefetch_data; // Prefetch request for this archive, in flight or staged
+
             // Scene streaming extradata
             // Boundary data
             wi::primitive::AABB bounds;
+            uint32_t bounds_version = 0; // Bumped when the bounds arrive from the stream, so the stream index picks them up
+            // Bundle data
+            std::string bundle_file; // Actual path of the bundle, empty if the archive uses loose files
+            Bundle bundle;
             // Preview data
             wi::scene::TransformComponent preview_transform;
             wi::ecs::Entity previewID; // Preview of the scene, single entity
@@ -32,12 +76,15 @@ namespace Game{
                 UNINITIALIZED,
                 UNLOADED,
                 LOADING,
-                LOADED
+                LOADED,
+                FAILED // The file could not be streamed, it is not requested again
             };
             LoadState load_state = LoadState::UNINITIALIZED; // Check loading progress of streaming
 
-            void Init(); // Initialize archive before anything - for prefab only
+            void Init(); // Initialize archive before anything - for prefab only, bounds and preview arrive with the stream
             void Load(wi::ecs::Entity clone_prefabID = wi::ecs::INVALID_ENTITY);
+            void Prefetch(float priority); // Stream ahead of time for prefabID, the data is kept aside until Load asks for it
+            void Instance(const wi::vector<wi::ecs::Entity>& clone_prefabIDs); // Clone a loaded archive into all of these prefabs in one go
             void Unload(wi::ecs::Entity clone_prefabID = wi::ecs::INVALID_ENTITY);
         };
         struct StreamData
@@ -50,18 +97,96 @@ namespace Game{
             StreamType stream_type;
             std::string file; // File mapping for archive
             std::string actual_file; // Actual file path for loading the scene file
-            wi::unordered_map<uint64_t, wi::ecs::Entity> remap;
+            RemapTable remap;
             wi::ecs::Entity clone_prefabID = wi::ecs::INVALID_ENTITY; // Used also by preview for entity ID
             std::shared_ptr<Scene> block; // Scene file where the serialization happens
 
+            std::string bundle_file; // Actual bundle path, tried before the loose files
+            Bundle bundle;
+            Filesystem::FileView section_view; // Mapped bundle section or pack entry, read on the I/O threads and released once deserialized
+            bool stream_ready = false; // The I/O threads found the data
+
+            // Textures that a memory archive could not resolve, read on the I/O threads and decoded by the next stream worker
+            struct TextureRead
+            {
+                wi::ecs::Entity materialID = wi::ecs::INVALID_ENTITY;
+                int slot = 0;
+                std::string file;
+                Filesystem::FileView view; // Pack entry, empty if the texture is a loose file
+                wi::vector<uint8_t> data; // Loose file contents
+            };
+            wi::vector<TextureRead> texture_reads;
+            bool texture_ready = false; // The texture reads are done, only decoding is left
+
             // Prefab specific data
             bool is_prefab = false;
+            wi::primitive::AABB bounds;
+            bool has_bounds = false;
             wi::scene::TransformComponent preview_transform;
             wi::vector<std::pair<wi::ecs::Entity, float>> fade_data;
+            uint64_t resident_bytes = 0; // Estimated memory of the deserialized block, taken over by the archive once merged
+
+            // Scheduling data
+            float priority = 0.f; // Lower streams first, set from the distance of the nearest prefab that wants this file
+            wi::Timer request_timer; // Starts when the request is made
+            float wait_time = 0.f; // Milliseconds from the request until the stream worker picked it up
+            uint64_t sequence = 0; // Submission order, completions are finished in this order
+
+            // Prefetch data
+            bool prefetch = false; // Streamed ahead of time, only staged on finish
+            bool staged = false; // Streamed and waiting for the prefab to come into range
+            wi::ecs::Entity prefabID = wi::ecs::INVALID_ENTITY; // Prefab that the remap was taken from
+
+            // Finish progress, merging a block into the scene can be spread over several frames
+            enum class FinishStep
+            {
+                BEGIN,
+                MERGE,
+                ATTACH,
+                DONE
+            };
+            FinishStep finish_step = FinishStep::BEGIN;
+            size_t finish_cursor = 0;
+            wi::vector<std::string> finish_components; // Component managers to merge, in order
+            size_t finish_deferred = 0; // Components from here on make entities render or simulate, they are merged in the same step as the attach
+            wi::vector<wi::ecs::Entity> finish_entities; // Remapped entities to attach to the prefab
         };
         struct StreamJob
         {
-            wi::vector<std::shared_ptr<StreamData>> stream_queue;
+            wi::vector<std::shared_ptr<StreamData>> stream_pending; // Requests waiting to be scheduled, reordered every frame - main thread only
+            BoundedQueue<std::shared_ptr<StreamData>> stream_queue; // Requests read from disk and handed over to the stream workers
+            std::atomic<uint32_t> stream_read_active = {0}; // Requests still reading on the I/O threads
+            BoundedQueue<std::shared_ptr<StreamData>> stream_callbacks; // Completions handed back to the main thread
+            std::mutex overflow_mutex;
+            wi::vector<std::shared_ptr<StreamData>> stream_queue_overflow; // Requests that found the next queue full, the scheduler hands them on - guarded by overflow_mutex
+            wi::vector<std::shared_ptr<StreamData>> stream_callbacks_overflow; // Completions that found stream_callbacks full - guarded by overflow_mutex
+            wi::vector<std::shared_ptr<StreamData>> stream_reorder; // Completions that arrived before an earlier request finished - main thread only
+            wi::unordered_set<std::string> stream_prefetch; // Files with a live prefetch request - main thread only
+            std::atomic<uint32_t> stream_worker_active = {0}; // Running stream workers
+            BoundedQueue<std::shared_ptr<Scene>> block_pool{8}; // Cleared staging scenes, workers take them instead of building new ones
+            std::atomic<uint32_t> block_pool_hit_count = {0};
+            std::atomic<uint32_t> block_pool_miss_count = {0};
+            uint64_t submit_sequence = 0;
+            uint64_t finish_sequence = 0;
+        };
+        struct StreamStats
+        {
+            uint32_t pending_count = 0; // Requests waiting to be scheduled
+            uint32_t queue_count = 0; // Requests handed over to the stream worker
+            uint32_t cancelled_count = 0; // Requests dropped because their prefab left range before streaming started
+            uint32_t finished_count = 0;
+            float wait_time_avg = 0.f; // Milliseconds, moving average
+            float wait_time_max = 0.f; // Milliseconds
+            float finish_time = 0.f; // Milliseconds spent finishing streams on the last frame
+            float finish_time_max = 0.f; // Milliseconds
+            uint32_t finish_backlog = 0; // Completions waiting to be finished
+            uint64_t resident_bytes = 0; // Estimated memory of all loaded archives
+            uint32_t evicted_count = 0; // Cached archives dropped to stay in the memory budget
+            uint32_t prefetch_count = 0; // Prefetch requests made
+            uint32_t prefetch_hit_count = 0; // Loads that were served by a prefetch
+            uint32_t prefetch_dropped_count = 0; // Prefetches that left the predicted path before their prefab came into range
+            uint32_t block_pool_hit_count = 0; // Streams that deserialized into a pooled staging scene
+            uint32_t block_pool_miss_count = 0; // Streams that had to build a new staging scene
         };
 
         struct Prefab
@@ -85,13 +210,14 @@ namespace Game{
             float stream_distance_multiplier = 1.f;
 
             // Runtime data
-            wi::unordered_map<uint64_t, wi::ecs::Entity> remap; // Remap data for the serialized file, also used for entity listing
+            RemapTable remap; // Remap data for the serialized file, also used for entity listing
             wi::unordered_map<std::string, wi::ecs::Entity> entity_name_map; // For fast entity searching
             bool loaded = false; // Has the prefab been loaded or not?
             bool disabled = false;
+            float residency_time = 0.f; // Seconds since the prefab got loaded
 
             // Fade management
-            wi::ecs::Entity preview_object; // Object for preview
+            wi::ecs::Entity preview_object = wi::ecs::INVALID_ENTITY; // Object for preview
             float fade_factor = 0.f; // Fade factor - 1 is fully loaded - 0 is unloaded
             wi::vector<std::pair<wi::ecs::Entity, float>> fade_data; // Original object's transparency are stored here
 
@@ -100,11 +226,193 @@ namespace Game{
             void Disable(); // Disable all components from the prefab
             void Unload(); // Remove all components from the prefab
             wi::ecs::Entity tostash_prefabID = wi::ecs::INVALID_ENTITY; // Just to stash remap data to scene database
+
+            // The component manager moves prefabs around when it grows, reorders or removes, only the last owner releases the entities
+            Prefab() = default;
+            Prefab(const Prefab&) = default;
+            Prefab& operator=(const Prefab&) = default;
+            Prefab(Prefab&& other) noexcept; // Leaves the source without entities
+            Prefab& operator=(Prefab&& other) noexcept; // Releases the entities of this prefab first, then takes over the source's
             ~Prefab(); // Custom destructor to handle things
+        private:
+            void Release(); // Removes the preview and every entity of the prefab
+        };
+        // Spatial index for prefab streaming
+        // DISTANCE prefabs are bucketed into a uniform grid by their world-space stream bounds,
+        // so the prefab update only visits the ones around the loader sphere
+        struct StreamIndex
+        {
+            struct Entry
+            {
+                XMFLOAT4X4 world; // Prefab transform that the cells were computed with
+                Prefab::StreamMode stream_mode = Prefab::StreamMode::DIRECT;
+                float stream_distance_multiplier = 1.f;
+                uint32_t bounds_version = 0; // Archive bounds version that the cells were computed with
+                std::string file; // Archive file that the prefab was indexed with
+                bool spatial = false; // Stored in the grid, otherwise the prefab is visited every frame
+                int32_t cell_min[3] = {};
+                int32_t cell_max[3] = {};
+                uint32_t slot = 0; // Location of the cached world bounds
+            };
+            // Cached world-space stream bounds, recomputed only when the prefab changes
+            // Stored as SoA so the visibility test can run on 4 prefabs at once
+            struct BoundsCache
+            {
+                wi::vector<float> min_x, min_y, min_z;
+                wi::vector<float> max_x, max_y, max_z;
+                wi::vector<float> radius;
+                wi::vector<wi::ecs::Entity> entity;
+            };
+            float cell_size = 64.f; // World-space size of a grid cell
+            uint32_t cell_limit = 4096; // Prefabs that cover more cells than this are not stored in the grid
+
+            wi::unordered_map<wi::ecs::Entity, Entry> entries;
+            BoundsCache bounds;
+            wi::unordered_map<uint64_t, wi::vector<wi::ecs::Entity>> cells;
+            wi::unordered_set<wi::ecs::Entity> nonspatial; // Prefabs that can't be culled by position (DIRECT, SCREEN_ESTATE, MANUAL)
+            wi::unordered_set<wi::ecs::Entity> active; // Prefabs that are loaded, fading or requested, visited until they settle
+            wi::unordered_map<std::string, wi::vector<wi::ecs::Entity>> files; // Indexed prefabs of each archive, so archive changes reach them
+            wi::unordered_set<wi::ecs::Entity> dirty; // Prefabs to reindex on the next update
+            bool brute_force = false; // Visit every indexed prefab on every update instead of querying the grid, the baseline for benchmarks
+
+            void Insert(wi::ecs::Entity prefabID, Entry entry, const wi::primitive::AABB& world_bounds);
+            void Remove(wi::ecs::Entity prefabID);
+            void MarkArchive(const std::string& file); // Mark every prefab of the archive dirty
+            void Query(const XMFLOAT4& sphere, wi::vector<wi::ecs::Entity>& result) const; // Append all prefabs from the cells that overlap the sphere
+            // Squared distance from a point to the cached bounds (box_distance_sq) and to their center (center_distance_sq) for a batch of slots
+            void DistanceBatch(const wi::vector<uint32_t>& slots, const XMFLOAT3& point, float* box_distance_sq, float* center_distance_sq) const;
+        };
+        // Serialized components of the entities that were disabled together, one allocation for all of them
+        // While compressing is set the compression job owns every other field, the main thread waits for it before touching them
+        struct InactiveSlab
+        {
+            wi::vector<uint8_t> data;
+            uint64_t raw_size = 0; // Size of data when it is not compressed
+            bool compressed = false;
+            std::atomic<bool> compressing = {false}; // Set while a background job packs data, released by the job when it is done
+            float idle_time = 0; // Seconds since the slab was last written or read
         };
         struct Inactive
         {
-            wi::vector<uint8_t> inactive_storage;
+            std::shared_ptr<InactiveSlab> slab; // Serialized components that the cold store has no handler for, can be nullptr
+            uint64_t offset = 0; // Where this entity's storage starts in the slab
+            uint64_t size = 0;
+        };
+        // Parallel component managers that hold the components of disabled entities
+        // Disable and enable move the component data between the live and the cold manager, nothing gets encoded
+        // Cold managers are owned by the store and kept out of the component library, so saves, merges and staging blocks never see them
+        // Scene::Entity_Remove clears them right away, entities removed by the engine are swept out over the next frames
+        struct ColdStore
+        {
+            struct Handler
+            {
+                wi::ecs::ComponentManager_Interface* live = nullptr;
+                wi::ecs::ComponentManager_Interface* cold = nullptr;
+                size_t sweep_cursor = 0; // Next cold component to check for a removed entity
+                virtual ~Handler() = default;
+                virtual void Disable(wi::ecs::Entity entity) = 0; // Live to cold
+                virtual void Enable(wi::ecs::Entity entity) = 0; // Cold to live
+            };
+            template<typename T>
+            struct TypedHandler : public Handler
+            {
+                wi::ecs::ComponentManager<T>& live_manager;
+                wi::ecs::ComponentManager<T> cold_manager;
+                TypedHandler(wi::ecs::ComponentManager<T>& live_manager) : live_manager(live_manager)
+                {
+                    live = &live_manager;
+                    cold = &cold_manager;
+                }
+                void Disable(wi::ecs::Entity entity) override { Move(live_manager, cold_manager, entity); }
+                void Enable(wi::ecs::Entity entity) override { Move(cold_manager, live_manager, entity); }
+                static void Move(wi::ecs::ComponentManager<T>& source, wi::ecs::ComponentManager<T>& target, wi::ecs::Entity entity)
+                {
+                    T* component = source.GetComponent(entity);
+                    if(component == nullptr)
+                        return;
+                    T* existing = target.GetComponent(entity);
+                    T& moved = (existing != nullptr) ? *existing : target.Create(entity);
+                    moved = std::move(*component);
+                    source.Remove(entity);
+                }
+            };
+
+            wi::unordered_map<std::string, std::unique_ptr<Handler>> handlers; // Keyed by the live component library name
+            wi::vector<std::string> fallback_list; // Disabled components without a handler, these are still serialized into an inactive slab
+
+            ColdStore(wi::scene::Scene& wiscene);
+            Handler* Find(const std::string& componentID);
+            void Remove(wi::ecs::Entity entity); // Clear the entity from every cold manager
+            // Drops cold components whose entity lost its inactive component, so the entity was removed elsewhere
+            // Checks up to limit components of each manager per call
+            void Sweep(const wi::ecs::ComponentManager_Interface& inactives, size_t limit);
+        };
+
+        // Direct copy of components for Entity_Clone, types without a handler are cloned through an archive
+        struct ComponentCopy
+        {
+            struct Handler
+            {
+                virtual ~Handler() = default;
+                // Copy the component of source_entity in source to target_entity, entity references are remapped like the serializer would
+                virtual void Copy(wi::ecs::ComponentManager_Interface& source, wi::ecs::Entity source_entity, wi::ecs::Entity target_entity, wi::ecs::EntitySerializer& seri) = 0;
+            };
+            template<typename T>
+            struct TypedHandler : public Handler
+            {
+                wi::ecs::ComponentManager<T>& target;
+                void(*remap)(T&, wi::ecs::EntitySerializer&); // Fixes up entity references, can be nullptr
+                TypedHandler(wi::ecs::ComponentManager<T>& target, void(*remap)(T&, wi::ecs::EntitySerializer&)) : target(target), remap(remap) {}
+                void Copy(wi::ecs::ComponentManager_Interface& source, wi::ecs::Entity source_entity, wi::ecs::Entity target_entity, wi::ecs::EntitySerializer& seri) override
+                {
+                    auto& typed_source = static_cast<wi::ecs::ComponentManager<T>&>(source);
+                    if(!typed_source.Contains(source_entity))
+                        return;
+                    T* existing = target.GetComponent(target_entity);
+                    T& copied = (existing != nullptr) ? *existing : target.Create(target_entity);
+                    // Live components are copied within the same manager, Create may have grown it so the source is looked up after
+                    copied = *typed_source.GetComponent(source_entity);
+                    if(remap != nullptr)
+                        remap(copied, seri);
+                }
+            };
+
+            wi::unordered_map<std::string, std::unique_ptr<Handler>> handlers; // Keyed by the component library name
+
+            ComponentCopy(wi::scene::Scene& wiscene);
+            Handler* Find(const std::string& componentID);
+        };
+
+        // Filter list resolved against the component library once, clone, disable and enable run from these without hashing names
+        struct ComponentPlan
+        {
+            struct Step
+            {
+                wi::ecs::ComponentManager_Interface* component_manager = nullptr;
+                uint64_t version = 0;
+                ColdStore::Handler* cold = nullptr; // Moves to the cold store on disable
+                ComponentCopy::Handler* copy = nullptr; // Cloned without an archive
+                uint32_t fallback_slot = ~0u; // Jump header slot in inactive storage, ~0u if the component is not stored there
+            };
+            wi::vector<Step> steps;
+        };
+
+        // Entity liveness by entity id, two bits per entity - main thread only
+        // Entities are marked alive when the scene streams or clones them in and removed through Entity_Remove
+        // The engine removes entities without telling the scene, so an alive entry is only a hint that Entity_Exists confirms
+        struct PresenceIndex
+        {
+            enum class State : uint8_t
+            {
+                UNKNOWN = 0,
+                ALIVE = 1,
+                REMOVED = 2
+            };
+            wi::vector<uint64_t> bits;
+
+            State Get(wi::ecs::Entity entity) const;
+            void Set(wi::ecs::Entity entity, State state);
+            void SetBatch(const wi::vector<wi::ecs::Entity>& entities, State state);
         };
 
         // Component data attached to scene
@@ -125,6 +433,15 @@ namespace Game{
         wi::ecs::ComponentManager<Component_Prefab>& prefabs = wiscene.componentLibrary.Register<Component_Prefab>("Game::Scene::Prefab");
         wi::ecs::ComponentManager<Component_Inactive>& inactives = wiscene.componentLibrary.Register<Component_Inactive>("Game::Scene::Inactive");
         wi::ecs::ComponentManager<Component_Script>& scripts = wiscene.componentLibrary.Register<Component_Script>("Game::Scene::Script");
+        ColdStore cold_store{wiscene};
+        ComponentCopy component_copy{wiscene};
+        PresenceIndex presence;
+        ComponentPlan cold_plan; // Disabled components that move to the cold store
+        ComponentPlan fallback_plan; // Disabled components that are serialized to inactive slabs, in jump header order
+        ComponentPlan full_clone_plan;
+        ComponentPlan shallow_clone_plan;
+
+        Scene();
 
         std::string current_scene; // Current filename that is used to point the root scene from scene_db
         wi::unordered_map<std::string, Archive> scene_db; // Lists all scenes referenced in this current game session
@@ -134,16 +451,43 @@ namespace Game{
         float stream_transition_speed = 3.f; // speed*framepseed
         XMFLOAT4 stream_loader_bounds = XMFLOAT4(0,0,0,10.f); // level streaming object
         float stream_loader_screen_estate = 0.5f; // until it is 10% of screen estate we do unload
+        float stream_unload_distance_multiplier = 1.25f; // Loaded prefabs stay until they are this much farther than the loader radius
+        float stream_unload_screen_estate_multiplier = 0.8f; // Loaded prefabs stay until their screen estate drops below this much of the load threshold
+        float stream_min_residency_time = 2.f; // Seconds a loaded prefab is kept before it can start fading out
+        StreamIndex stream_index; // Spatial lookup of prefabs for the stream update
+        uint32_t stream_schedule_limit = 4; // How many requests the stream workers can hold at once, the rest stay pending and get reprioritized
+        uint32_t stream_worker_count = 4; // Stream workers that deserialize in parallel
+        uint32_t stream_read_limit = 2; // Stream requests the scheduler keeps on the I/O threads at the same time, the rest stay pending
+        float stream_finish_budget_ms = 2.f; // Time per frame for merging streamed blocks into the scene, big blocks resume next frame
+        uint64_t stream_memory_budget = 1024ull * 1024ull * 1024ull; // Estimated bytes of loaded archives, cached archives are evicted past this
+        uint64_t stream_frame = 0; // Prefab update counter, used for eviction order
+        float stream_prefetch_time = 1.f; // Seconds to look ahead along the loader's velocity, 0 turns prefetching off
+        uint32_t stream_prefetch_step_limit = 16; // Maximum spheres tested along the predicted path
+        XMFLOAT3 stream_loader_velocity = XMFLOAT3(0,0,0); // Smoothed from the loader position of recent frames
+        XMFLOAT3 stream_loader_previous = XMFLOAT3(0,0,0);
+        bool stream_loader_tracked = false;
+        StreamStats stream_stats;
+        uint32_t cold_sweep_limit = 256; // Cold components of each manager checked per frame for entities removed by the engine
+        float inactive_compress_time = 30.f; // Seconds an inactive slab stays untouched before it is compressed in the background, 0 turns it off
+        wi::vector<std::weak_ptr<InactiveSlab>> inactive_slabs; // Every slab that is still alive, visited for compression
+        wi::unordered_map<wi::ecs::Entity, std::future<Filesystem::ReadResult>> script_reads; // Script files being read before their first run - main thread only
 
         // Scene operation functions
         bool Entity_Exists(wi::ecs::Entity entity);
+        void Entity_Remove(wi::ecs::Entity entity); // Removes from the wiscene and the cold store, use instead of wiscene.Entity_Remove
+        void Prefab_MarkDirty(wi::ecs::Entity prefabID); // Reindex the prefab for streaming on the next update, moves and setting changes are also picked up without it
         void Entity_Disable(wi::ecs::Entity entity);
         void Entity_Enable(wi::ecs::Entity entity);
+        // Same as above for many entities, goes through one component manager at a time and runs the managers in parallel
+        void Entity_DisableBatch(const wi::vector<wi::ecs::Entity>& entities);
+        void Entity_EnableBatch(const wi::vector<wi::ecs::Entity>& entities);
         wi::ecs::Entity Entity_Clone(
             wi::ecs::Entity entity, 
             wi::ecs::EntitySerializer& seri, 
             bool deep_copy = false, 
             wi::unordered_map<uint64_t, wi::ecs::Entity>* clone_seri = nullptr);
+        // Attach many (child, parent) pairs in one pass, the children are already in local space
+        void Component_AttachBatch(const wi::vector<std::pair<wi::ecs::Entity, wi::ecs::Entity>>& attach_list);
 
         // Load the scene file
         void Load(std::string file);
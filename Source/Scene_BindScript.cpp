@@ -69,12 +69,18 @@ namespace Game::Scripting
         // SCRIPT SECTION START
         const char Script_Bind::className[] = "FrameworkScriptComponent";
         Luna<Script_Bind>::FunctionType Script_Bind::methods[] = {
+            lunamethod(Script_Bind, IsFailed),
             {NULL, NULL}
         };
         Luna<Script_Bind>::PropertyType Script_Bind::properties[] = {
             lunaproperty(Script_Bind, file),
             {NULL, NULL}
         };
+        int Script_Bind::IsFailed(lua_State *L)
+        {
+            wi::lua::SSetBool(L, component->failed);
+            return 1;
+        }
         // SCRIPT SECTION END
 
         // SCENE SECTION START
@@ -86,17 +92,23 @@ namespace Game::Scripting
             lunamethod(Scene_Bind, Component_GetPrefab),
             lunamethod(Scene_Bind, Component_GetScript),
             lunamethod(Scene_Bind, Component_Remove),
+            lunamethod(Scene_Bind, Prefab_MarkDirty),
             lunamethod(Scene_Bind, Entity_Exists),
+            lunamethod(Scene_Bind, Entity_Remove),
             lunamethod(Scene_Bind, Entity_Disable),
             lunamethod(Scene_Bind, Entity_Enable),
             lunamethod(Scene_Bind, Entity_Clone),
             lunamethod(Scene_Bind, Load),
+            lunamethod(Scene_Bind, GetStreamStats),
             {NULL, NULL}
         };
         Luna<Scene_Bind>::PropertyType Scene_Bind::properties[] = {
             lunaproperty(Scene_Bind, stream_transition_speed),
             lunaproperty(Scene_Bind, stream_loader_bounds),
             lunaproperty(Scene_Bind, stream_loader_screen_estate),
+            lunaproperty(Scene_Bind, stream_unload_distance_multiplier),
+            lunaproperty(Scene_Bind, stream_unload_screen_estate_multiplier),
+            lunaproperty(Scene_Bind, stream_min_residency_time),
             {NULL, NULL}
         };
         int Scene_Bind::GetWiScene(lua_State* L)
@@ -194,6 +206,20 @@ namespace Game::Scripting
             }
             return 0;
         }
+        int Scene_Bind::Prefab_MarkDirty(lua_State *L)
+        {
+            int argc = wi::lua::SGetArgCount(L);
+            if(argc > 0)
+            {
+                wi::ecs::Entity entity = (wi::ecs::Entity)wi::lua::SGetLongLong(L, 1);
+                scene->Prefab_MarkDirty(entity);
+            }
+            else
+            {
+                wi::lua::SError(L, "Scene.Prefab_MarkDirty(int entity) not enough arguments!");
+            }
+            return 0;
+        }
         int Scene_Bind::Entity_Exists(lua_State *L)
         {
             int argc = wi::lua::SGetArgCount(L);
@@ -209,6 +235,20 @@ namespace Game::Scripting
             }
             return 0;
         }
+        int Scene_Bind::Entity_Remove(lua_State *L)
+        {
+            int argc = wi::lua::SGetArgCount(L);
+            if(argc > 0)
+            {
+                wi::ecs::Entity entity = (wi::ecs::Entity)wi::lua::SGetLongLong(L, 1);
+                scene->Entity_Remove(entity);
+            }
+            else
+            {
+                wi::lua::SError(L, "Scene.Entity_Remove(int entity) not enough arguments!");
+            }
+            return 0;
+        }
         int Scene_Bind::Entity_Disable(lua_State *L)
         {
             int argc = wi::lua::SGetArgCount(L);
@@ -271,6 +311,44 @@ namespace Game::Scripting
             }
             return 0;
         }
+        int Scene_Bind::GetStreamStats(lua_State *L)
+        {
+            const Game::Scene::StreamStats& stream_stats = scene->stream_stats;
+            lua_newtable(L);
+            lua_pushinteger(L, stream_stats.pending_count);
+            lua_setfield(L, -2, "pending_count");
+            lua_pushinteger(L, stream_stats.queue_count);
+            lua_setfield(L, -2, "queue_count");
+            lua_pushinteger(L, stream_stats.cancelled_count);
+            lua_setfield(L, -2, "cancelled_count");
+            lua_pushinteger(L, stream_stats.finished_count);
+            lua_setfield(L, -2, "finished_count");
+            lua_pushnumber(L, stream_stats.wait_time_avg);
+            lua_setfield(L, -2, "wait_time_avg");
+            lua_pushnumber(L, stream_stats.wait_time_max);
+            lua_setfield(L, -2, "wait_time_max");
+            lua_pushnumber(L, stream_stats.finish_time);
+            lua_setfield(L, -2, "finish_time");
+            lua_pushnumber(L, stream_stats.finish_time_max);
+            lua_setfield(L, -2, "finish_time_max");
+            lua_pushinteger(L, stream_stats.finish_backlog);
+            lua_setfield(L, -2, "finish_backlog");
+            lua_pushinteger(L, stream_stats.resident_bytes);
+            lua_setfield(L, -2, "resident_bytes");
+            lua_pushinteger(L, stream_stats.evicted_count);
+            lua_setfield(L, -2, "evicted_count");
+            lua_pushinteger(L, stream_stats.prefetch_count);
+            lua_setfield(L, -2, "prefetch_count");
+            lua_pushinteger(L, stream_stats.prefetch_hit_count);
+            lua_setfield(L, -2, "prefetch_hit_count");
+            lua_pushinteger(L, stream_stats.prefetch_dropped_count);
+            lua_setfield(L, -2, "prefetch_dropped_count");
+            lua_pushinteger(L, stream_stats.block_pool_hit_count);
+            lua_setfield(L, -2, "block_pool_hit_count");
+            lua_pushinteger(L, stream_stats.block_pool_miss_count);
+            lua_setfield(L, -2, "block_pool_miss_count");
+            return 1;
+        }
         // SCENE SECTION END
 
         int GetScene(lua_State* L)
@@ -76,6 +76,8 @@ namespace Game::Scripting
 
             wi::lua::StringProperty file;
             PropertyFunction(file)
+
+            int IsFailed(lua_State *L);
         };
 
         class Scene_Bind
@@ -94,6 +96,9 @@ namespace Game::Scripting
                 stream_transition_speed = wi::lua::FloatProperty(&scene->stream_transition_speed);
                 stream_loader_bounds = wi::lua::VectorProperty(&scene->stream_loader_bounds);
                 stream_loader_screen_estate = wi::lua::FloatProperty(&scene->stream_loader_screen_estate);
+                stream_unload_distance_multiplier = wi::lua::FloatProperty(&scene->stream_unload_distance_multiplier);
+                stream_unload_screen_estate_multiplier = wi::lua::FloatProperty(&scene->stream_unload_screen_estate_multiplier);
+                stream_min_residency_time = wi::lua::FloatProperty(&scene->stream_min_residency_time);
             }
 
             Scene_Bind(Game::Scene* scene) :scene(scene) { BuildBindings(); }
@@ -110,6 +115,12 @@ namespace Game::Scripting
             PropertyFunction(stream_loader_bounds)
             wi::lua::FloatProperty stream_loader_screen_estate;
             PropertyFunction(stream_loader_screen_estate)
+            wi::lua::FloatProperty stream_unload_distance_multiplier;
+            PropertyFunction(stream_unload_distance_multiplier)
+            wi::lua::FloatProperty stream_unload_screen_estate_multiplier;
+            PropertyFunction(stream_unload_screen_estate_multiplier)
+            wi::lua::FloatProperty stream_min_residency_time;
+            PropertyFunction(stream_min_residency_time)
 
             int GetWiScene(lua_State* L);
 
@@ -121,12 +132,16 @@ namespace Game::Scripting
 
             int Component_Remove(lua_State* L);
 
+            int Prefab_MarkDirty(lua_State* L);
             int Entity_Exists(lua_State* L);
+            int Entity_Remove(lua_State* L);
             int Entity_Disable(lua_State* L);
             int Entity_Enable(lua_State* L);
             int Entity_Clone(lua_State* L);
 
             int Load(lua_State* L);
+
+            int GetStreamStats(lua_State* L);
         };
 
         int GetScene(lua_State*L);
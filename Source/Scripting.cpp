@@ -1,11 +1,35 @@
 #include "Scripting.h"
 #include "Scripting_Globals.h"
 #include "Scene_BindScript.h"
+#include "Filesystem.h"
 
 #include <wiApplication_BindLua.h>
 
 static const char* WILUA_ERROR_PREFIX = "[Lua Error] ";
 
+// Loads and runs script text with the framework parameters attached, returns false if it did not compile or raised an error
+bool _internal_DoText(lua_State* L, const std::string& filename, std::string command, uint32_t PID, const std::string& customparameters_prepend, const std::string& customparameters_append)
+{
+    Game::Scripting::AppendFrameworkScriptingParameters(command, filename, PID, customparameters_prepend, customparameters_append);
+
+    int status = luaL_loadstring(L, command.c_str());
+    if (status == 0)
+        status = lua_pcall(L, 0, LUA_MULTRET, 0);
+    if (status == 0)
+        return true;
+
+    const char* str = lua_tostring(L, -1);
+    if (str != nullptr)
+    {
+        std::string ss;
+        ss += WILUA_ERROR_PREFIX;
+        ss += str;
+        wi::backlog::post(ss, wi::backlog::LogLevel::Error);
+    }
+    lua_pop(L, 1); // remove error message
+    return false;
+}
+
 // Add custom c bind functions here
 int Bind_DoFile(lua_State* L)
 {
@@ -24,33 +48,16 @@ int Bind_DoFile(lua_State* L)
 
         wi::vector<uint8_t> filedata;
 
-        if (wi::helper::FileRead(filename, filedata))
+        // Virtual paths resolve through the mounts and packs, anything else is read as an OS path
+        if (Game::Filesystem::FileRead(filename, filedata) || wi::helper::FileRead(filename, filedata))
         {
             if(PID == wi::ecs::INVALID_ENTITY)
                 PID = wi::ecs::CreateEntity();
             std::string command = std::string(filedata.begin(), filedata.end());
-            Game::Scripting::AppendFrameworkScriptingParameters(command, filename, PID, customparameters_prepend, customparameters_append);
-
-            int status = luaL_loadstring(L, command.c_str());
-            if (status == 0)
-            {
-                status = lua_pcall(L, 0, LUA_MULTRET, 0);
-                auto return_PID = std::to_string(PID);
-                wi::lua::SSetString(L, return_PID);
-            }
-            else
-            {
-                const char* str = lua_tostring(L, -1);
-
-                if (str == nullptr)
-                    return 0;
-
-                std::string ss;
-                ss += WILUA_ERROR_PREFIX;
-                ss += str;
-                wi::backlog::post(ss, wi::backlog::LogLevel::Error);
-                lua_pop(L, 1); // remove error message
-            }
+            if (!_internal_DoText(L, filename, command, PID, customparameters_prepend, customparameters_append))
+                return 0;
+            auto return_PID = std::to_string(PID);
+            wi::lua::SSetString(L, return_PID);
         }
     }
     else
@@ -79,6 +86,15 @@ void Game::Scripting::Init(wi::Application* app)
     wi::lua::RegisterFunc("GetAppRuntime", Bind_GetAppRuntime);
 }
 
+bool Game::Scripting::DoBuffer(const std::string& filename, const uint8_t* data, size_t size, uint32_t PID, const std::string& customparameters_prepend)
+{
+    lua_State* L = wi::lua::GetLuaState();
+    int top = lua_gettop(L);
+    bool success = _internal_DoText(L, filename, std::string((const char*)data, size), PID, customparameters_prepend, "");
+    lua_settop(L, top); // Nothing from the script stays on the stack, there is no Lua caller to hand it to
+    return success;
+}
+
 // Script tracking
 wi::unordered_map<uint32_t, std::string> scripts;
 wi::unordered_map<std::string, wi::vector<size_t>> scripts_filerefs;
@@ -9,6 +9,8 @@ namespace Game::Scripting
     void Update(float dt);
     // Attach this game framework's scripting parameters
     void AppendFrameworkScriptingParameters(std::string& script, std::string filename, uint32_t PID, const std::string& customparameters_prepend = "", const std::string& customparameters_append = "");
+    // Same as dofile for a script that is already in memory, returns false if it did not compile or raised an error
+    bool DoBuffer(const std::string& filename, const uint8_t* data, size_t size, uint32_t PID, const std::string& customparameters_prepend = "");
 
     // Callback system
     // To add new callbacks for any async processes that communicate with the scripting system
@@ -25,5 +27,6 @@ namespace Game::Scripting
         // Runtime data
         // PID uses entityID!
         bool done_init = false; // Check if the script has been initialized or not
+        bool failed = false; // The script could not be read, did not compile or raised an error while starting
     };
 }
\ No newline at end of file
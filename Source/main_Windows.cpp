@@ -57,6 +57,10 @@ int APIENTRY wWinMain(_In_ HINSTANCE hInstance,
 
 	Game::Filesystem::Register_FS("content/", "Data/Content/", false);
     Game::Filesystem::Register_FS("shader/", "Data/Shader/", false);
+#ifdef IS_DEV
+    if(!Dev::GetCommandData()->has_command) // PACK_BUILD rewrites the pack, it can't stay mapped while that happens
+#endif
+    Game::Filesystem::Register_FSPack("content/", "Data/Content.pack"); // Optional, built with Dev -t PACK_BUILD -i Data/Content -o Data/Content.pack
 
     wi::renderer::SetShaderSourcePath(Game::Filesystem::GetActualPath("shader/"));
     wi::renderer::SetShaderPath(Game::Filesystem::GetActualPath("shader/"));